@@ -7,8 +7,10 @@
 #define RL_LOGGER_HPP
 
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
+#include <unordered_map>
 #include <fstream>
 #include <iostream>
 #include <chrono>
@@ -18,42 +20,80 @@
 class RLLogger
 {
 public:
-    RLLogger();
+    // 每个数据块的行数，块在写满前一次性分配
+    explicit RLLogger(size_t chunk_rows = 4096);
     ~RLLogger();
 
-    // 记录数据的通用接口
+    // 注册列并返回列ID，同名列返回已有ID。热路径中应只使用ID
+    int RegisterColumn(const std::string& name);
+    // 为前num_joints个关节各注册6列：_target _actual _dq _kp _kd _tau_est
+    void RegisterJoints(int num_joints);
+    int GetColumn(const std::string& name) const;
+    size_t NumColumns() const { return column_names_.size(); }
+
+    // 开始新的一行（一个控制周期），未写入的单元格在CSV中留空
+    void BeginRow();
+
+    // 记录数据的通用接口，写入当前行。没有当前行或该单元格本行已写过时自动开始新的一行
+    void Record(int column, double value);
+    // 按名字记录，每次调用都要查找列名，只适合低频数据
     void Record(const std::string& key, double value);
-    
+
     // 记录关节数据的便捷接口
-    void RecordJointData(int joint_index, double target_q, double actual_q, 
+    void RecordJointData(int joint_index, double target_q, double actual_q,
                         double actual_dq, double kp, double kd, double tau_est);
-    
+
+    // 预先分配能容纳rows行的数据块
+    void Reserve(size_t rows);
+
     // 保存数据到CSV文件
     void SaveToCSV(const std::string& filename = "");
-    
-    // 清空所有记录的数据
+
+    // 清空所有记录的数据，已注册的列和ID保持不变
     void Clear();
-    
+
     // 获取数据摘要
     std::string GetSummary() const;
-    
+
     // 检查是否有数据
     bool HasData() const;
 
 private:
-    std::map<std::string, std::vector<double>> data_;
-    
+    static const int kJointFields = 6;
+
+    // 行优先的定宽记录，width为分配该块时的列数
+    struct Chunk
+    {
+        size_t width = 0;
+        size_t rows = 0;
+        size_t capacity = 0;   // data可容纳的double个数
+        std::unique_ptr<double[]> data;
+    };
+
+    size_t chunk_rows_;
+    std::vector<Chunk> chunks_;
+    size_t active_chunks_;   // chunks_中已使用的块数，其余为预分配的空块
+    double* row_;            // 当前行，nullptr表示尚未开始
+    size_t num_rows_;
+
+    std::vector<std::string> column_names_;
+    std::unordered_map<std::string, int> column_ids_;
+    std::vector<int> joint_columns_;   // 每个关节第一列的ID，-1表示未注册
+
     // 关节名称映射
     std::map<int, std::string> joint_names_;
-    
+
     // 初始化关节名称映射
     void InitJointNames();
-    
+
     // 获取关节名称
     std::string GetJointName(int joint_index) const;
-    
+
     // 生成时间戳文件名
     std::string GenerateFilename() const;
+
+    Chunk& NextChunk();
+    void WidenRow();
 };
 
 #endif // RL_LOGGER_HPP
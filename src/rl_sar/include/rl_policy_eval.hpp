@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef RL_POLICY_EVAL_HPP
+#define RL_POLICY_EVAL_HPP
+
+#include "rl_sdk.hpp"
+#include "observation_buffer.hpp"
+
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One control step of a trajectory, the robot inputs RL_Real::RunModel reads
+struct EvalStep
+{
+    std::array<double, 4> quaternion{{1.0, 0.0, 0.0, 0.0}}; // w, x, y, z
+    std::array<double, 3> gyroscope{{0.0, 0.0, 0.0}};
+    std::array<double, 3> commands{{0.0, 0.0, 0.0}};        // x, y, yaw
+    std::vector<double> q;
+    std::vector<double> dq;
+};
+using EvalTrajectory = std::vector<EvalStep>;
+
+/**
+ * CSV trajectory, one row per RL step. Columns are matched by name, unknown ones are ignored and missing ones keep
+ * their default (identity quaternion, zero velocities and commands, default_dof_pos):
+ *   quat_w quat_x quat_y quat_z gyro_x gyro_y gyro_z cmd_x cmd_y cmd_yaw q_0 .. q_<n-1> dq_0 .. dq_<n-1>
+ */
+EvalTrajectory LoadTrajectoryCSV(const std::string &path, const ModelParams &params);
+// Small sinusoidal joint motion and body sway around default_dof_pos, the same seed gives the same trajectory
+EvalTrajectory SyntheticTrajectory(const ModelParams &params, int steps, unsigned int seed);
+
+// One environment of the batch. Observation and output code is the runtime's, only the robot is replaced by a trajectory
+class RL_Eval : public RL
+{
+public:
+    RL_Eval() {}
+
+    // Fills robot_state and obs the way RL_Real::RunModel does before Forward
+    void SetStep(const EvalStep &step);
+
+    void GetState(RobotState<double> *state) override {}
+    void SetCommand(const RobotCommand<double> *command) override {}
+};
+
+/**
+ * Runs N trajectories through a policy as one batch of N.
+ *
+ * The policy is loaded once with RL::LoadPolicy, as InitRL does, and every environment activates the same bundle.
+ * Per step the environments compute their observations in parallel (TBB) into the rows of one [N, num_obs] batch,
+ * the stacked history comes from a single ObservationBuffer with num_envs = N, and the backend runs on the batch:
+ * TorchScript takes the whole [N, input] tensor in one forward, ONNX sessions are bound to a batch of one so every
+ * worker thread owns a session and runs its slice of rows. ComputeOutput then runs per environment in parallel.
+ */
+class PolicyEvaluator
+{
+public:
+    enum class Backend
+    {
+        Auto,   // ONNX when loaded, otherwise TorchScript, the order of RL::Forward
+        Onnx,
+        Torch
+    };
+
+    PolicyEvaluator(const std::string &robot_name, const std::string &config_name, const std::string &ang_vel_type);
+
+    const ModelParams &Params() const { return loader.params; }
+
+    // Writes one CSV row per environment and step: env, step, actions, output_dof_pos
+    void Run(const std::vector<EvalTrajectory> &trajectories, Backend backend, const std::string &output_path);
+
+private:
+    RL_Eval loader;
+    std::string robot_path;
+    std::shared_ptr<PolicyBundle> policy;
+
+    std::vector<std::unique_ptr<RL_Eval>> envs;
+    std::vector<std::shared_ptr<ONNXInferenceEngine>> worker_engines;
+    ObservationBuffer history_obs_buf;
+
+    void InitEnvs(int num_envs, Backend backend);
+    std::shared_ptr<ONNXInferenceEngine> LoadWorkerEngine() const;
+    static void WriteHeader(std::FILE *file, int num_actions, int num_of_dofs);
+};
+
+#endif // RL_POLICY_EVAL_HPP
@@ -9,13 +9,17 @@
 #define RL_REAL_G1_HPP
 
 // #define PLOT
-// #define CSV_LOGGER
+// #define TELEMETRY
 // #define USE_ROS
 
 #include "rl_sdk.hpp"
 #include "observation_buffer.hpp"
 #include "loop.hpp"
 #include "fsm.hpp"
+#include "triple_buffer.hpp"
+#include "crc32.hpp"
+#include "telemetry_recorder.hpp"
+#include "telemetry_reader.hpp"
 
 #include <unitree/robot/channel/channel_publisher.hpp>
 #include <unitree/robot/channel/channel_subscriber.hpp>
@@ -218,16 +222,22 @@ class RL_Real : public RL
 #endif
 {
 public:
-    RL_Real();
+    // connect = false skips the motion switcher, the DDS channels and the loops, for Replay
+    explicit RL_Real(bool connect = true, const std::string &lowstate_record_path = "");
     ~RL_Real();
 
+    // Feeds a recording of the control loop input through GetState -> StateController -> RunModel -> SetCommand with
+    // the DDS publisher stubbed out, optionally at the recorded pace. Writes the commands and per-stage timings of
+    // every tick to output_path (CSV) when given and prints a timing summary.
+    int Replay(const std::string &recording_path, bool realtime, const std::string &output_path);
+
 private:
     // rl functions
-    torch::Tensor Forward() override;
     void GetState(RobotState<double> *state) override;
     void SetCommand(const RobotCommand<double> *command) override;
     void RunModel();
     void RobotControl();
+    void UpdateControlInput();
 
 
 
@@ -236,6 +246,8 @@ private:
     std::shared_ptr<LoopFunc> loop_control;
     std::shared_ptr<LoopFunc> loop_rl;
     std::shared_ptr<LoopFunc> loop_plot;
+    std::shared_ptr<LoopFunc> loop_stats;
+    void PrintLoopStats();
 
     // plot
     const int plot_size = 100;
@@ -250,8 +262,9 @@ private:
     void ImuTorsoHandler(const void *message);
     unitree::robot::b2::MotionSwitcherClient msc;
     LowCmd_ unitree_low_command;
-    LowState_ unitree_low_state;
-    IMUState_ unitree_imu_torso;
+    // written by the DDS callbacks, GetState reads the newest complete message in place
+    TripleBuffer<LowState_> unitree_low_state_buffer;
+    TripleBuffer<IMUState_> unitree_imu_torso_buffer;
     Mode mode_pr;
     uint8_t mode_machine;
     Gamepad gamepad;
@@ -260,6 +273,13 @@ private:
     ChannelSubscriberPtr<LowState_> lowstate_subscriber;
     ChannelSubscriberPtr<IMUState_> imutorso_subscriber;
 
+    // LowState_/IMUState_ as read by GetState on every control tick, in the telemetry format so
+    // scripts/telemetry_to_csv.py converts it too. Only the fields GetState uses are kept.
+    TelemetryRecorder lowstate_recorder;
+    static std::vector<std::string> LowStateColumns();
+    void RecordLowState(const LowState_ &low_state, const IMUState_ &imu_torso);
+    static void LowStateFromRow(const double *row, LowState_ &low_state, IMUState_ &imu_torso);
+
     // others
     int motiontime = 0;
     std::vector<double> mapped_joint_positions;
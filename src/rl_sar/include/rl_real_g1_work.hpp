@@ -7,7 +7,7 @@
 #define RL_REAL_G1_HPP
 
 // #define PLOT
-// #define CSV_LOGGER
+// #define TELEMETRY
 // #define USE_ROS
 
 #include "rl_sdk.hpp"
@@ -220,7 +220,6 @@ public:
 
 private:
     // rl functions
-    torch::Tensor Forward() override;
     void GetState(RobotState<double> *state) override;
     void SetCommand(const RobotCommand<double> *command) override;
     void RunModel();
@@ -7,7 +7,7 @@
 #define RL_SIM_HPP
 
 // #define PLOT
-// #define CSV_LOGGER
+// #define TELEMETRY
 
 #include "rl_sdk.hpp"
 #include "observation_buffer.hpp"
@@ -58,7 +58,6 @@ public:
 
 private:
     // rl functions
-    torch::Tensor Forward() override;
     void GetState(RobotState<double> *state) override;
     void SetCommand(const RobotCommand<double> *command) override;
     void RunModel();
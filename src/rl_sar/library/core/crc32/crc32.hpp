@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CRC32_HPP
+#define CRC32_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32_HAS_HARDWARE 1
+#else
+#define CRC32_HAS_HARDWARE 0
+#endif
+
+/**
+ * CRC-32 of the Unitree LowCmd_ checksum: polynomial 0x04C11DB7, initial value 0xFFFFFFFF, no final XOR,
+ * data consumed as 32-bit words MSB first (CRC-32/MPEG-2 over big-endian words). All variants return the
+ * same value, Compute picks the fastest one available.
+ */
+namespace crc32
+{
+    const uint32_t kPolynomial = 0x04c11db7;
+    const uint32_t kInit = 0xFFFFFFFF;
+
+    // t[k][b]: CRC register after feeding byte b followed by 8 * k zero bits
+    struct Tables
+    {
+        uint32_t t[8][256];
+
+        constexpr Tables() : t{}
+        {
+            for (uint32_t b = 0; b < 256; ++b)
+            {
+                uint32_t crc = b << 24;
+                for (int bit = 0; bit < 8; ++bit)
+                {
+                    crc = (crc & 0x80000000) ? (crc << 1) ^ kPolynomial : (crc << 1);
+                }
+                t[0][b] = crc;
+            }
+            for (int k = 1; k < 8; ++k)
+            {
+                for (uint32_t b = 0; b < 256; ++b)
+                {
+                    t[k][b] = (t[k - 1][b] << 8) ^ t[0][t[k - 1][b] >> 24];
+                }
+            }
+        }
+    };
+
+    inline const Tables &GetTables()
+    {
+        static constexpr Tables tables{};
+        return tables;
+    }
+
+    // Reference implementation, one polynomial step per bit
+    inline uint32_t Bitwise(const uint32_t *data, size_t len)
+    {
+        uint32_t crc = kInit;
+        for (size_t i = 0; i < len; ++i)
+        {
+            uint32_t xbit = 1u << 31;
+            for (int bits = 0; bits < 32; ++bits)
+            {
+                crc = (crc & 0x80000000) ? (crc << 1) ^ kPolynomial : (crc << 1);
+                if (data[i] & xbit)
+                {
+                    crc ^= kPolynomial;
+                }
+                xbit >>= 1;
+            }
+        }
+        return crc;
+    }
+
+    // Eight table lookups per two words
+    inline uint32_t SliceBy8(const uint32_t *data, size_t len)
+    {
+        const Tables &tables = GetTables();
+        uint32_t crc = kInit;
+        size_t i = 0;
+        for (; i + 2 <= len; i += 2)
+        {
+            uint32_t x = crc ^ data[i];
+            uint32_t y = data[i + 1];
+            crc = tables.t[7][x >> 24] ^ tables.t[6][(x >> 16) & 0xff] ^ tables.t[5][(x >> 8) & 0xff] ^ tables.t[4][x & 0xff] ^
+                  tables.t[3][y >> 24] ^ tables.t[2][(y >> 16) & 0xff] ^ tables.t[1][(y >> 8) & 0xff] ^ tables.t[0][y & 0xff];
+        }
+        if (i < len)
+        {
+            uint32_t x = crc ^ data[i];
+            crc = tables.t[3][x >> 24] ^ tables.t[2][(x >> 16) & 0xff] ^ tables.t[1][(x >> 8) & 0xff] ^ tables.t[0][x & 0xff];
+        }
+        return crc;
+    }
+
+#if CRC32_HAS_HARDWARE
+    // ARMv8 CRC32W implements the bit-reflected form of the same polynomial, reflecting the register and every
+    // input word turns it into the MSB-first variant
+    inline uint32_t Hardware(const uint32_t *data, size_t len)
+    {
+        uint32_t crc = __rbit(kInit);
+        for (size_t i = 0; i < len; ++i)
+        {
+            crc = __crc32w(crc, __rbit(data[i]));
+        }
+        return __rbit(crc);
+    }
+#endif
+
+    inline uint32_t Compute(const uint32_t *data, size_t len)
+    {
+#if CRC32_HAS_HARDWARE
+        return Hardware(data, len);
+#else
+        return SliceBy8(data, len);
+#endif
+    }
+}
+
+#endif // CRC32_HPP
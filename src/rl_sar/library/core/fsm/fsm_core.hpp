@@ -6,34 +6,112 @@
 #include <unordered_map>
 #include <memory>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include "loop.hpp"
 
 class FSMState
 {
 public:
-    FSMState(std::string name) : state_name_(std::move(name)) {}
+    FSMState(std::string name) : state_name_(std::move(name)), state_id_(-1) {}
     virtual ~FSMState() = default;
 
     virtual void Enter() = 0;
     virtual void Run() = 0;
     virtual void Exit() = 0;
-    virtual std::string CheckChange() { return state_name_; }
+
+    // Returns the ID of the state to switch to, or GetStateId() to stay. The default walks the transition
+    // table in declaration order and takes the first entry whose condition holds.
+    virtual int CheckChange()
+    {
+        for (const Transition &transition : transitions_)
+        {
+            if (transition.target >= 0 && transition.condition())
+                return transition.target;
+        }
+        return state_id_;
+    }
+
+    // Declares a transition to the state named target, resolved to its ID when the FSM is built
+    void AddTransition(std::function<bool()> condition, const std::string &target)
+    {
+        transitions_.push_back({std::move(condition), target, -1});
+    }
+
+    // Blocking work the state needs before Enter (file I/O, model loading). The FSM runs it on a worker
+    // thread while the current state keeps running, an exception aborts the transition. It may still be
+    // running after the transition timed out or was abandoned, until FSM::WaitPrepare returns.
+    virtual bool IsPrepared() const { return true; }
+    virtual void Prepare() {}
+    virtual void OnPrepareFailed(const std::string &reason) {}
 
     const std::string &GetStateName() const { return state_name_; }
+    int GetStateId() const { return state_id_; }
 
 protected:
     std::string state_name_;
+
+private:
+    friend class FSM;
+
+    struct Transition
+    {
+        std::function<bool()> condition;
+        std::string target_name;
+        int target;
+    };
+    std::vector<Transition> transitions_;
+    int state_id_;  // dense index into FSM::state_list_, assigned by AddState
 };
 
 class FSM
 {
 public:
     FSM() : current_state_(nullptr), next_state_(nullptr), mode_(Mode::NORMAL) {}
+    ~FSM() { WaitPrepare(); }
 
     void AddState(std::shared_ptr<FSMState> state)
     {
+        auto it = states_.find(state->GetStateName());
+        if (it != states_.end())
+        {
+            state->state_id_ = it->second->state_id_;
+            state_list_[state->state_id_] = state;
+        }
+        else
+        {
+            state->state_id_ = static_cast<int>(state_list_.size());
+            state_list_.push_back(state);
+        }
         states_[state->GetStateName()] = state;
     }
 
+    // Maps the target names of every transition table to state IDs, unknown targets are dropped
+    void ResolveTransitions()
+    {
+        for (auto &state : state_list_)
+        {
+            for (auto &transition : state->transitions_)
+            {
+                transition.target = GetStateId(transition.target_name);
+                if (transition.target < 0)
+                {
+                    std::cout << "\033[0;33m[FSM]\033[0m " << state->GetStateName() << ": transition to unknown state " << transition.target_name << " ignored" << std::endl;
+                }
+            }
+        }
+    }
+
+    int GetStateId(const std::string &name) const
+    {
+        auto it = states_.find(name);
+        return it != states_.end() ? it->second->GetStateId() : -1;
+    }
+
+    const std::vector<std::shared_ptr<FSMState>> &GetStates() const { return state_list_; }
+
     void SetInitialState(const std::string &name)
     {
         current_state_ = states_.at(name);
@@ -44,50 +122,202 @@ public:
 
     void RequestStateChange(const std::string& state_name)
     {
-        if (states_.find(state_name) != states_.end() && current_state_ && current_state_->GetStateName() != state_name)
+        RequestStateChange(GetStateId(state_name));
+    }
+
+    void RequestStateChange(int state_id)
+    {
+        if (state_id >= 0 && state_id < static_cast<int>(state_list_.size()) && current_state_ && current_state_->GetStateId() != state_id)
         {
-            next_state_ = states_.at(state_name);
+            next_state_ = state_list_[state_id];
             mode_ = Mode::CHANGE;
             std::cout << std::endl << "\033[0;34m[FSM]\033[0m Request switch from " << current_state_->GetStateName() << " to " << next_state_->GetStateName() << std::endl;
         }
     }
 
+    void SetPrepareTimeout(double seconds) { prepare_timeout_ = seconds; }
+
+    // Blocks until every prepare worker has returned. Whoever owns what Prepare() touches calls it before tearing
+    // that down, the destructor only covers the FSM itself.
+    void WaitPrepare()
+    {
+        if (prepare_task_ && prepare_task_->worker.joinable())
+            prepare_task_->worker.join();
+        for (auto &task : abandoned_tasks_)
+        {
+            if (task->worker.joinable())
+                task->worker.join();
+        }
+        abandoned_tasks_.clear();
+    }
+
     void Run()
     {
         if (!current_state_)
             return;
 
+        if (!abandoned_tasks_.empty())
+            JoinFinishedTasks();
+
         if (mode_ == Mode::NORMAL)
         {
             current_state_->Run();
-            std::string next = current_state_->CheckChange();
-            if (next != current_state_->GetStateName())
+            int next = current_state_->CheckChange();
+            if (next != current_state_->GetStateId())
             {
                 mode_ = Mode::CHANGE;
-                next_state_ = states_.at(next);
+                next_state_ = state_list_[next];
                 std::cout << std::endl << "\033[0;34m[FSM]\033[0m Switch from " << current_state_->GetStateName() << " to " << next_state_->GetStateName() << std::endl;
             }
         }
         else if (mode_ == Mode::CHANGE)
         {
-            current_state_->Exit();
-            current_state_ = next_state_;
-            current_state_->Enter();
-            mode_ = Mode::NORMAL;
+            if (next_state_->IsPrepared())
+            {
+                CommitChange();
+            }
+            else
+            {
+                StartPrepare();
+                current_state_->Run();
+            }
+        }
+        else if (mode_ == Mode::PREPARE)
+        {
+            // The current state keeps streaming its command until the next one is ready
             current_state_->Run();
+
+            int status = prepare_task_->status.load(std::memory_order_acquire);
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - prepare_task_->start).count();
+            if (status == PrepareTask::DONE)
+            {
+                std::cout << std::endl << "\033[0;34m[FSM]\033[0m " << next_state_->GetStateName() << " prepared in " << static_cast<int>(elapsed * 1000) << " ms" << std::endl;
+                CommitChange();
+            }
+            else if (status == PrepareTask::FAILED)
+            {
+                AbortPrepare(prepare_task_->error);
+            }
+            else if (elapsed > prepare_timeout_)
+            {
+                AbortPrepare("timed out after " + std::to_string(static_cast<int>(elapsed * 1000)) + " ms");
+            }
+            else
+            {
+                int next = current_state_->CheckChange();
+                if (next != current_state_->GetStateId() && next != next_state_->GetStateId())
+                {
+                    // Retarget, the abandoned task is joined once it returns
+                    mode_ = Mode::CHANGE;
+                    next_state_ = state_list_[next];
+                    ReleasePrepare();
+                    std::cout << std::endl << "\033[0;34m[FSM]\033[0m Switch from " << current_state_->GetStateName() << " to " << next_state_->GetStateName() << std::endl;
+                }
+            }
         }
     }
 
     enum class Mode
     {
         NORMAL,
-        CHANGE
+        CHANGE,
+        PREPARE
     };
 
-    std::unordered_map<std::string, std::shared_ptr<FSMState>> states_;
+    std::unordered_map<std::string, std::shared_ptr<FSMState>> states_;  // by name, for setup and requests
     std::shared_ptr<FSMState> current_state_;
     std::shared_ptr<FSMState> next_state_;
     Mode mode_;
+
+private:
+    std::vector<std::shared_ptr<FSMState>> state_list_;  // by ID, for dispatch
+
+    struct PrepareTask
+    {
+        enum Status { RUNNING, DONE, FAILED };
+        std::atomic<int> status{RUNNING};
+        std::string error;  // written before status is released
+        std::chrono::steady_clock::time_point start;
+        std::thread worker;
+    };
+    std::shared_ptr<PrepareTask> prepare_task_;
+    // given up on by a timeout or a retarget while still running, joined once they return
+    std::vector<std::shared_ptr<PrepareTask>> abandoned_tasks_;
+    double prepare_timeout_ = 10.0;
+
+    void StartPrepare()
+    {
+        auto task = std::make_shared<PrepareTask>();
+        task->start = std::chrono::steady_clock::now();
+        std::shared_ptr<FSMState> state = next_state_;
+        // Joined by the FSM, never detached: Prepare() works on the state and the objects it refers to
+        task->worker = std::thread([task, state]()
+        {
+            // Started from the control loop, it must not compete with it at real-time priority on its CPUs
+            ThreadScheduleReset::resetCurrentThread();
+            try
+            {
+                state->Prepare();
+                task->status.store(PrepareTask::DONE, std::memory_order_release);
+            }
+            catch (const std::exception &e)
+            {
+                task->error = e.what();
+                task->status.store(PrepareTask::FAILED, std::memory_order_release);
+            }
+        });
+        prepare_task_ = task;
+        mode_ = Mode::PREPARE;
+        std::cout << std::endl << "\033[0;34m[FSM]\033[0m Preparing " << state->GetStateName() << " in the background" << std::endl;
+    }
+
+    void AbortPrepare(const std::string &reason)
+    {
+        std::cout << std::endl << "\033[0;31m[FSM]\033[0m Switch to " << next_state_->GetStateName() << " aborted: " << reason << std::endl;
+        next_state_->OnPrepareFailed(reason);
+        next_state_ = current_state_;
+        ReleasePrepare();
+        mode_ = Mode::NORMAL;
+    }
+
+    void CommitChange()
+    {
+        current_state_->Exit();
+        current_state_ = next_state_;
+        current_state_->Enter();
+        ReleasePrepare();
+        mode_ = Mode::NORMAL;
+        current_state_->Run();
+    }
+
+    // Drops the current task, joining it if its worker is done and keeping it for later otherwise, so the control
+    // loop never waits on a load
+    void ReleasePrepare()
+    {
+        if (!prepare_task_)
+            return;
+        if (prepare_task_->status.load(std::memory_order_acquire) == PrepareTask::RUNNING)
+            abandoned_tasks_.push_back(prepare_task_);
+        else
+            prepare_task_->worker.join();
+        prepare_task_.reset();
+    }
+
+    void JoinFinishedTasks()
+    {
+        for (auto it = abandoned_tasks_.begin(); it != abandoned_tasks_.end();)
+        {
+            if ((*it)->status.load(std::memory_order_acquire) != PrepareTask::RUNNING)
+            {
+                (*it)->worker.join();
+                it = abandoned_tasks_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
 };
 
 class FSMFactory
@@ -98,6 +328,8 @@ public:
     virtual std::string GetType() const = 0;
     virtual std::vector<std::string> GetSupportedStates() const = 0;
     virtual std::string GetInitialState() const = 0;
+    // Policy configs the states can switch to, relative to the robot directory, preloaded at startup
+    virtual std::vector<std::string> GetPolicies() const { return {}; }
 };
 
 class FSMManager
@@ -141,6 +373,7 @@ public:
             if (state)
                 fsm->AddState(state);
         }
+        fsm->ResolveTransitions();
         fsm->SetInitialState(factory->GetInitialState());
         std::cout << "[FSMManager] FSM created for type: " << type << std::endl;
         return fsm;
@@ -151,6 +384,14 @@ public:
         return factories_.find(type) != factories_.end();
     }
 
+    std::vector<std::string> GetPolicies(const std::string &type) const
+    {
+        auto it = factories_.find(type);
+        if (it == factories_.end())
+            return {};
+        return it->second->GetPolicies();
+    }
+
     std::vector<std::string> GetSupportedTypes() const
     {
         std::vector<std::string> types;
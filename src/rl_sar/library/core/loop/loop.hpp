@@ -16,29 +16,253 @@
 #include <vector>
 #include <sstream>
 #include <iomanip>
+#include <array>
+#include <cmath>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 
-class LoopFunc
+// Thread scheduling of one loop, applied by the loop thread itself when it starts.
+// Threads inherit the policy, priority and CPUs of the thread that creates them, so anything a fifo/rr or pinned
+// loop starts (std::thread, ONNX Runtime sessions, ...) must run under a ThreadScheduleReset.
+struct LoopSchedule
+{
+    std::string policy = "other";  // "other", "fifo" or "rr"
+    int priority = 0;              // 1-99 for fifo and rr, ignored for other
+    std::vector<int> cpus;         // CPUs the thread may run on, empty for no pinning
+};
+
+// Moves the calling thread to SCHED_OTHER on the CPUs of the main thread for its lifetime and restores the previous
+// policy, priority and CPUs on destruction. Failures are reported, the thread keeps running either way.
+class ThreadScheduleReset
 {
 public:
-    LoopFunc(const std::string &name, double period, std::function<void()> func, int bindCPU = -1)
-        : _name(name), _period(period), _func(func), _bindCPU(bindCPU), _running(false) {}
+    ThreadScheduleReset()
+    {
+        _saved = pthread_getschedparam(pthread_self(), &_policy, &_param) == 0 &&
+                 pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &_cpus) == 0;
+        resetCurrentThread();
+    }
 
-    void start()
+    // The same without the restore, for a thread that never goes back to real-time work
+    static void resetCurrentThread()
     {
-        _running = true;
-        log("[Loop Start] named: " + _name + ", period: " + formatPeriod() + "(ms)" + (_bindCPU != -1 ? ", run at cpu: " + std::to_string(_bindCPU) : ", cpu unspecified"));
-        if (_bindCPU != -1)
+        // The loops pin their own threads only, the main thread keeps the CPUs the process was started with
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        int err = sched_getaffinity(getpid(), sizeof(cpu_set_t), &cpus) == 0 ? pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus) : errno;
+        if (err != 0)
         {
-            _thread = std::thread(&LoopFunc::loop, this);
-            setThreadAffinity(_thread.native_handle(), _bindCPU);
+            std::cout << "[Loop Warning] cannot reset thread cpus: " << std::strerror(err) << std::endl;
         }
-        else
+
+        sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        err = pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+        if (err != 0)
+        {
+            std::cout << "[Loop Warning] cannot reset thread policy to other: " << std::strerror(err) << std::endl;
+        }
+    }
+
+    ~ThreadScheduleReset()
+    {
+        if (!_saved)
+        {
+            return;
+        }
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &_cpus);
+        if (err == 0)
+        {
+            err = pthread_setschedparam(pthread_self(), _policy, &_param);
+        }
+        if (err != 0)
         {
-            _thread = std::thread(&LoopFunc::loop, this);
+            std::cout << "[Loop Warning] cannot restore thread schedule: " << std::strerror(err) << std::endl;
         }
-        _thread.detach();
     }
 
+    ThreadScheduleReset(const ThreadScheduleReset &) = delete;
+    ThreadScheduleReset &operator=(const ThreadScheduleReset &) = delete;
+
+private:
+    bool _saved;
+    int _policy;
+    sched_param _param;
+    cpu_set_t _cpus;
+};
+
+// Fixed-bucket duration histogram with a single writer. record() only does relaxed atomic loads and stores,
+// snapshot() can run on any thread and sees each counter consistently but not all counters at one instant.
+class LoopHistogram
+{
+public:
+    // Upper bounds of the buckets in microseconds on a 1-2-5 series, the last bucket is unbounded
+    static const int kBuckets = 20;
+
+    static int64_t bucketUpperNs(int bucket)
+    {
+        static const int64_t bounds[kBuckets - 1] = {
+            1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000};
+        return bucket < kBuckets - 1 ? bounds[bucket] * 1000 : INT64_MAX;
+    }
+
+    struct Snapshot
+    {
+        std::array<uint64_t, kBuckets> buckets{};
+        uint64_t count = 0;
+        int64_t sumNs = 0;
+        int64_t maxNs = 0;
+
+        double meanUs() const { return count ? sumNs / 1e3 / count : 0.0; }
+        double maxUs() const { return maxNs / 1e3; }
+        // Upper bound of the bucket holding the p-th fraction of the samples, capped at the observed max
+        double percentileUs(double p) const
+        {
+            if (count == 0) return 0.0;
+            uint64_t rank = static_cast<uint64_t>(std::ceil(p * count));
+            uint64_t seen = 0;
+            for (int i = 0; i < kBuckets; ++i)
+            {
+                seen += buckets[i];
+                if (seen >= rank && seen > 0) return std::min(bucketUpperNs(i), maxNs) / 1e3;
+            }
+            return maxUs();
+        }
+    };
+
+    void record(int64_t ns)
+    {
+        if (ns < 0) ns = 0;
+        int bucket = 0;
+        while (bucket < kBuckets - 1 && ns > bucketUpperNs(bucket)) ++bucket;
+        increment(_buckets[bucket], 1);
+        increment(_count, 1);
+        _sumNs.store(_sumNs.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+        if (ns > _maxNs.load(std::memory_order_relaxed)) _maxNs.store(ns, std::memory_order_relaxed);
+    }
+
+    Snapshot snapshot() const
+    {
+        Snapshot snap;
+        for (int i = 0; i < kBuckets; ++i) snap.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+        snap.count = _count.load(std::memory_order_relaxed);
+        snap.sumNs = _sumNs.load(std::memory_order_relaxed);
+        snap.maxNs = _maxNs.load(std::memory_order_relaxed);
+        return snap;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> _buckets{};
+    std::atomic<uint64_t> _count{0};
+    std::atomic<int64_t> _sumNs{0};
+    std::atomic<int64_t> _maxNs{0};
+
+    static void increment(std::atomic<uint64_t> &counter, uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+};
+
+class LoopFunc
+{
+public:
+    struct Stats
+    {
+        LoopHistogram::Snapshot execTime;     // duration of func()
+        LoopHistogram::Snapshot wakeLateness; // cycle start relative to its scheduled start
+        uint64_t overruns = 0;
+        uint64_t skipped = 0;
+    };
+
+    // Relative: sleep period - elapsed after each cycle, in whole milliseconds.
+    // Absolute: sleep until the next deadline on CLOCK_MONOTONIC with clock_nanosleep(TIMER_ABSTIME), deadlines
+    //           advance by exactly one period so there is no drift and periods below 1 ms work.
+    enum class Timing
+    {
+        Relative,
+        Absolute
+    };
+
+    // What an absolute loop does when a cycle ends after the next deadline.
+    // CatchUp: run the missed cycles back to back until it is on schedule again.
+    // Skip: drop the missed cycles and wait for the next deadline that is still ahead.
+    enum class OverrunPolicy
+    {
+        CatchUp,
+        Skip
+    };
+
+    LoopFunc(const std::string &name, double period, std::function<void()> func, int bindCPU = -1)
+        : _name(name), _period(period), _func(func), _bindCPU(bindCPU), _running(false),
+          _timing(Timing::Relative), _overrunPolicy(OverrunPolicy::Skip), _overruns(0), _skipped(0) {}
+
+    ~LoopFunc()
+    {
+        if (_thread.joinable())
+        {
+            shutdown();
+        }
+    }
+
+    // Must be called before start()
+    void setTiming(Timing timing, OverrunPolicy overrunPolicy = OverrunPolicy::Skip)
+    {
+        _timing = timing;
+        _overrunPolicy = overrunPolicy;
+    }
+
+    // Must be called before start(). Failures are reported when the thread starts, the loop still runs.
+    void setSchedule(const LoopSchedule &schedule)
+    {
+        _schedule = schedule;
+    }
+
+    uint64_t overrunCount() const { return _overruns.load(std::memory_order_relaxed); }
+    uint64_t skippedCount() const { return _skipped.load(std::memory_order_relaxed); }
+
+    Stats stats() const
+    {
+        Stats stats;
+        stats.execTime = _execTime.snapshot();
+        stats.wakeLateness = _wakeLateness.snapshot();
+        stats.overruns = overrunCount();
+        stats.skipped = skippedCount();
+        return stats;
+    }
+
+    std::string formatStats() const
+    {
+        Stats s = stats();
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(1)
+            << "[Loop Stats] named: " << _name << ", cycles: " << s.execTime.count
+            << ", exec(us) mean/p99/max: " << s.execTime.meanUs() << "/" << s.execTime.percentileUs(0.99) << "/" << s.execTime.maxUs()
+            << ", wake late(us) mean/p99/max: " << s.wakeLateness.meanUs() << "/" << s.wakeLateness.percentileUs(0.99) << "/" << s.wakeLateness.maxUs()
+            << ", overruns: " << s.overruns << ", skipped: " << s.skipped;
+        return oss.str();
+    }
+
+    // Prints formatStats(), for a reporting thread or after shutdown(). Never from a real-time loop, the console
+    // can block.
+    void logStats()
+    {
+        log(formatStats());
+    }
+
+    void start()
+    {
+        _running = true;
+        log("[Loop Start] named: " + _name + ", period: " + formatPeriod() + "(ms)" + (_timing == Timing::Absolute ? ", absolute deadlines" : "") + (_bindCPU != -1 ? ", run at cpu: " + std::to_string(_bindCPU) : (_schedule.cpus.empty() ? ", cpu unspecified" : "")));
+        _thread = std::thread(&LoopFunc::run, this);
+    }
+
+    // Returns once the loop thread has ended, func() is not running afterwards
+
     void shutdown()
     {
         {
@@ -62,20 +286,50 @@ private:
     std::mutex _mutex;
     std::condition_variable _cv;
     std::thread _thread;
+    Timing _timing;
+    OverrunPolicy _overrunPolicy;
+    std::atomic<uint64_t> _overruns;
+    std::atomic<uint64_t> _skipped;
+    LoopSchedule _schedule;
+    LoopHistogram _execTime;
+    LoopHistogram _wakeLateness;
+
+    void run()
+    {
+        applySchedule();
+
+        if (_timing == Timing::Absolute)
+        {
+            loopAbsolute();
+        }
+        else
+        {
+            loop();
+        }
+    }
 
     void loop()
     {
+        auto scheduled = std::chrono::steady_clock::now();
         while (_running)
         {
             auto start = std::chrono::steady_clock::now();
+            _wakeLateness.record(std::chrono::duration_cast<std::chrono::nanoseconds>(start - scheduled).count());
 
             _func();
 
             auto end = std::chrono::steady_clock::now();
+            _execTime.record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
             auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            if (end - start > std::chrono::duration<double>(_period))
+            {
+                _overruns.fetch_add(1, std::memory_order_relaxed);
+            }
             auto sleepTime = std::chrono::milliseconds(static_cast<int>((_period * 1000) - elapsed.count()));
+            scheduled = end;
             if (sleepTime.count() > 0)
             {
+                scheduled = end + sleepTime;
                 std::unique_lock<std::mutex> lock(_mutex);
                 if (_cv.wait_for(lock, sleepTime, [this]
                                  { return !_running; }))
@@ -86,10 +340,98 @@ private:
         }
     }
 
+    void loopAbsolute()
+    {
+        const int64_t periodNs = static_cast<int64_t>(std::llround(_period * 1e9));
+        // scheduled start of the current cycle
+        timespec next;
+        clock_gettime(CLOCK_MONOTONIC, &next);
+        int64_t lastReportNs = 0;
+
+        while (_running)
+        {
+            timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            _wakeLateness.record(toNs(start) - toNs(next));
+
+            _func();
+
+            timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            _execTime.record(toNs(now) - toNs(start));
+
+            addNs(next, periodNs);
+            const int64_t lateNs = toNs(now) - toNs(next);
+            if (lateNs > 0)
+            {
+                uint64_t overruns = _overruns.fetch_add(1, std::memory_order_relaxed) + 1;
+                if (_overrunPolicy == OverrunPolicy::Skip)
+                {
+                    // Every deadline up to now is dropped, the next cycle starts on the first one still ahead
+                    const int64_t missed = lateNs / periodNs + 1;
+                    _skipped.fetch_add(static_cast<uint64_t>(missed), std::memory_order_relaxed);
+                    addNs(next, missed * periodNs);
+                }
+                // At most one report per second, a 500 Hz loop would flood the console otherwise
+                if (toNs(now) - lastReportNs >= 1000000000LL)
+                {
+                    lastReportNs = toNs(now);
+                    std::ostringstream oss;
+                    oss << "[Loop Overrun] named: " << _name << ", late by " << std::fixed << std::setprecision(3)
+                        << lateNs / 1e6 << "(ms), overruns: " << overruns << ", skipped cycles: " << skippedCount();
+                    log(oss.str());
+                }
+                if (_overrunPolicy == OverrunPolicy::CatchUp)
+                {
+                    continue;
+                }
+            }
+
+            sleepUntil(next, now);
+        }
+    }
+
+    // Sleeps to the deadline in slices of at most kSleepSliceNs, shutdown() cannot wake clock_nanosleep and must not
+    // wait a whole long period. Returns early once the loop is stopped.
+    static const int64_t kSleepSliceNs = 100000000LL;
+    void sleepUntil(const timespec &deadline, timespec now)
+    {
+        while (_running)
+        {
+            timespec wake = deadline;
+            if (toNs(deadline) - toNs(now) > kSleepSliceNs)
+            {
+                wake = now;
+                addNs(wake, kSleepSliceNs);
+            }
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, nullptr) == EINTR)
+            {
+            }
+            if (toNs(wake) == toNs(deadline))
+            {
+                return;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &now);
+        }
+    }
+
+    static int64_t toNs(const timespec &ts)
+    {
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+    static void addNs(timespec &ts, int64_t ns)
+    {
+        int64_t total = ts.tv_nsec + ns;
+        ts.tv_sec += total / 1000000000LL;
+        ts.tv_nsec = total % 1000000000LL;
+    }
+
     std::string formatPeriod() const
     {
         std::ostringstream stream;
-        stream << std::fixed << std::setprecision(0) << _period * 1000;
+        double periodMs = _period * 1000;
+        stream << std::fixed << std::setprecision(periodMs == std::floor(periodMs) ? 0 : 3) << periodMs;
         return stream.str();
     }
 
@@ -100,16 +442,59 @@ private:
         std::cout << message << std::endl;
     }
 
-    void setThreadAffinity(std::thread::native_handle_type threadHandle, int cpuId)
+    void applySchedule()
     {
-        cpu_set_t cpuset;
-        CPU_ZERO(&cpuset);
-        CPU_SET(cpuId, &cpuset);
-        if (pthread_setaffinity_np(threadHandle, sizeof(cpu_set_t), &cpuset) != 0)
+        std::vector<int> cpus = _schedule.cpus;
+        if (cpus.empty() && _bindCPU != -1)
+        {
+            cpus.push_back(_bindCPU);
+        }
+        if (!cpus.empty())
+        {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            std::ostringstream list;
+            for (size_t i = 0; i < cpus.size(); ++i)
+            {
+                if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE)
+                {
+                    CPU_SET(cpus[i], &cpuset);
+                }
+                list << (i ? ", " : "") << cpus[i];
+            }
+            int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+            if (err != 0)
+            {
+                log("[Loop Warning] named: " + _name + ", cannot pin to cpus [" + list.str() + "]: " + std::strerror(err));
+            }
+            else
+            {
+                log("[Loop Schedule] named: " + _name + ", pinned to cpus [" + list.str() + "]");
+            }
+        }
+
+        int policy;
+        if (_schedule.policy == "fifo") policy = SCHED_FIFO;
+        else if (_schedule.policy == "rr") policy = SCHED_RR;
+        else if (_schedule.policy == "other") return;
+        else
+        {
+            log("[Loop Warning] named: " + _name + ", unknown scheduling policy '" + _schedule.policy + "', keeping the default");
+            return;
+        }
+
+        sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        param.sched_priority = _schedule.priority;
+        int err = pthread_setschedparam(pthread_self(), policy, &param);
+        if (err != 0)
+        {
+            std::string hint = err == EPERM ? " (needs root, CAP_SYS_NICE or an rtprio limit)" : "";
+            log("[Loop Warning] named: " + _name + ", cannot set " + _schedule.policy + " priority " + std::to_string(_schedule.priority) + ": " + std::strerror(err) + hint);
+        }
+        else
         {
-            std::ostringstream oss;
-            oss << "Error setting thread affinity: CPU " << cpuId << " may not be valid or accessible.";
-            throw std::runtime_error(oss.str());
+            log("[Loop Schedule] named: " + _name + ", policy: " + _schedule.policy + ", priority: " + std::to_string(_schedule.priority));
         }
     }
 };
@@ -4,6 +4,7 @@
  */
 
 #include "observation_buffer.hpp"
+#include <cstring>
 
 ObservationBuffer::ObservationBuffer() {}
 
@@ -41,50 +42,111 @@ void ObservationBuffer::reset(std::vector<int> reset_idxs, torch::Tensor new_obs
 
 void ObservationBuffer::insert(torch::Tensor new_obs)
 {
-    // Shift observations back.
-    torch::Tensor shifted_obs = obs_buf.index({torch::indexing::Slice(torch::indexing::None), torch::indexing::Slice(num_obs, num_obs * history_length)}).clone();
-    obs_buf.index({torch::indexing::Slice(torch::indexing::None), torch::indexing::Slice(0, num_obs * (history_length - 1))}) = shifted_obs;
+    if (history_length <= 0) throw std::logic_error("ObservationBuffer::insert on a buffer without history, construct it with a history_length");
 
-    // Add new observation.
-    obs_buf.index({torch::indexing::Slice(torch::indexing::None), torch::indexing::Slice(-num_obs, torch::indexing::None)}) = new_obs;
+    // Overwrite the oldest frame in place, the history is not shifted. A single env fed the float observation
+    // of RL::Forward is a plain copy into its slot, without the narrowed view.
+    if (num_envs == 1 && new_obs.scalar_type() == torch::kFloat32 && new_obs.is_contiguous() && new_obs.numel() == num_obs)
+    {
+        std::memcpy(obs_buf.data_ptr<float>() + head * num_obs, new_obs.data_ptr<float>(), num_obs * sizeof(float));
+    }
+    else
+    {
+        obs_buf.narrow(1, head * num_obs, num_obs).copy_(new_obs);
+    }
+    head = (head + 1) % history_length;
 }
 
-/**
- * @brief Gets history of observations indexed by obs_ids.
- *
- * @param obs_ids An array of integers with which to index the desired
- *                observations, where 0 is the latest observation and
- *                history_length - 1 is the oldest observation.
- * @return A torch::Tensor containing the concatenated observations.
- */
-torch::Tensor ObservationBuffer::get_obs_vec(std::vector<int> obs_ids)
+void ObservationBuffer::clear()
+{
+    if (obs_buf.defined()) obs_buf.zero_();
+    head = 0;
+}
+
+int ObservationBuffer::slot_of(int step) const
+{
+    return (head - 1 - step + 2 * history_length) % history_length;
+}
+
+void ObservationBuffer::set_obs_ids(const std::vector<int>& obs_ids)
 {
-    std::vector<torch::Tensor> obs;
+    plan_obs_ids = obs_ids;
+    gather_plan.clear();
+    gather_size = 0;
+
+    // Runs that continue the previous one in the same frame are merged
+    auto add_run = [this](int step, int src_offset, int len)
+    {
+        if (step < 0 || step >= history_length) throw std::out_of_range("Observation history step " + std::to_string(step) + " is outside the buffer");
+        if (!gather_plan.empty())
+        {
+            CopyRun& last = gather_plan.back();
+            if (last.step == step && last.src_offset + last.len == src_offset)
+            {
+                last.len += len;
+                gather_size += len;
+                return;
+            }
+        }
+        gather_plan.push_back({step, src_offset, gather_size, len});
+        gather_size += len;
+    };
 
-    if (this->priority == "time")
+    if (priority == "time")
     {
-        for (int i = 0; i < obs_ids.size(); ++i)
+        for (int step : obs_ids)
         {
-            int obs_id = obs_ids[i];
-            int slice_idx = history_length - obs_id - 1;
-            obs.push_back(obs_buf.index({torch::indexing::Slice(torch::indexing::None), torch::indexing::Slice(slice_idx * num_obs, (slice_idx + 1) * num_obs)}));
+            add_run(step, 0, num_obs);
         }
     }
-    else if(this->priority == "term")
+    else if (priority == "term")
     {
         int obs_offset = 0;
-        for (size_t i = 0; i < obs_dims.size(); ++i)
+        for (int dim : obs_dims)
         {
-            int dim = obs_dims[i];
             for (int step : obs_ids)
             {
-                int time_offset = (history_length - step - 1) * num_obs;
-                int pos = obs_offset + time_offset;
-                obs.push_back(obs_buf.index({torch::indexing::Slice(), torch::indexing::Slice(pos, pos + dim)}));
+                add_run(step, obs_offset, dim);
             }
             obs_offset += dim;
         }
     }
+    else
+    {
+        throw std::invalid_argument("Unknown observation history priority '" + priority + "'");
+    }
+}
+
+void ObservationBuffer::gather_obs_vec(float* out) const
+{
+    const float* buf = obs_buf.data_ptr<float>();
+    for (int env = 0; env < num_envs; ++env)
+    {
+        const float* row = buf + env * num_obs_total;
+        float* dst = out + env * gather_size;
+        for (const CopyRun& run : gather_plan)
+        {
+            std::memcpy(dst + run.dst_offset, row + slot_of(run.step) * num_obs + run.src_offset, run.len * sizeof(float));
+        }
+    }
+}
+
+/**
+ * @brief Gets history of observations indexed by obs_ids.
+ *
+ * @param obs_ids An array of integers with which to index the desired
+ *                observations, where 0 is the latest observation and
+ *                history_length - 1 is the oldest observation.
+ * @return A torch::Tensor containing the concatenated observations.
+ */
+torch::Tensor ObservationBuffer::get_obs_vec(std::vector<int> obs_ids)
+{
+    if (gather_plan.empty() || obs_ids != plan_obs_ids)
+    {
+        set_obs_ids(obs_ids);
+    }
 
-    return torch::cat(obs, -1);
+    torch::Tensor obs = torch::empty({num_envs, gather_size}, torch::dtype(torch::kFloat32));
+    gather_obs_vec(obs.data_ptr<float>());
+    return obs;
 }
@@ -8,6 +8,7 @@
 
 #include <torch/torch.h>
 #include <vector>
+#include <string>
 
 class ObservationBuffer
 {
@@ -17,16 +18,39 @@ public:
 
     void reset(std::vector<int> reset_idxs, torch::Tensor new_obs);
     void insert(torch::Tensor new_obs);
+    void clear();
     torch::Tensor get_obs_vec(std::vector<int> obs_ids);
 
+    // Precomputes the copy plan for obs_ids, gather_obs_vec then fills num_envs rows of obs_vec_size()
+    // floats at out without building intermediate tensors
+    void set_obs_ids(const std::vector<int>& obs_ids);
+    int obs_vec_size() const { return gather_size; }
+    void gather_obs_vec(float* out) const;
+
 private:
+    // Frames are kept in a ring of history_length slots, head is the slot the next insert writes
+    int slot_of(int step) const;
+
     int num_envs;
     std::vector<int> obs_dims;
     std::string priority;
     int num_obs = 0;
     int history_length = 0;
     int num_obs_total = 0;
+    int head = 0;
     torch::Tensor obs_buf;
+
+    // One contiguous copy from the frame `step` steps back into the output row
+    struct CopyRun
+    {
+        int step;
+        int src_offset;
+        int dst_offset;
+        int len;
+    };
+    std::vector<int> plan_obs_ids;
+    std::vector<CopyRun> gather_plan;
+    int gather_size = 0;
 };
 
 #endif // OBSERVATION_BUFFER_HPP
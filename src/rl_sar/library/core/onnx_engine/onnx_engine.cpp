@@ -10,13 +10,16 @@
 #include <iostream>
 #include <climits>
 #include <cstring>
+#include <algorithm>
+#include <cstdlib>
 
 // #ifdef USE_ONNXRUNTIME
 
 ONNXInferenceEngine::ONNXInferenceEngine() 
     : env_(ORT_LOGGING_LEVEL_WARNING, "RL_SAR_ONNX"),
       memory_info_(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)),
-      model_loaded_(false)
+      model_loaded_(false),
+      use_io_binding_(true)
 {
     session_options_.SetInterOpNumThreads(4);
     session_options_.SetIntraOpNumThreads(4);
@@ -25,6 +28,7 @@ ONNXInferenceEngine::ONNXInferenceEngine()
 
 ONNXInferenceEngine::~ONNXInferenceEngine() 
 {
+    ReleaseIoBinding();
     session_.reset();
 }
 
@@ -43,6 +47,9 @@ void ONNXInferenceEngine::LoadModel(const std::string& model_path)
         std::cout << "[ONNX Engine] Loading model: " << model_path << std::endl;
         // std::cout << "[ONNX Engine] Model file size: " << file_size << " bytes" << std::endl;
         
+        // Bound tensors refer to the previous session, drop them before replacing it
+        ReleaseIoBinding();
+
         // Create session with additional error checking
         try {
             session_ = std::make_unique<Ort::Session>(env_, model_path.c_str(), session_options_);
@@ -62,6 +69,8 @@ void ONNXInferenceEngine::LoadModel(const std::string& model_path)
         output_names_char_.clear();
         input_shapes_.clear();
         output_shapes_.clear();
+        input_types_.clear();
+        output_types_.clear();
         
         // Get input info with detailed validation
         for (size_t i = 0; i < num_inputs; ++i) {
@@ -119,6 +128,7 @@ void ONNXInferenceEngine::LoadModel(const std::string& model_path)
                 // }
                 
                 input_shapes_.push_back(input_shape);
+                input_types_.push_back(input_shape_info.GetElementType());
                 // std::cout << "[ONNX Engine] Input " << i << ": " << input_names_.back() << " shape: [";
                 // for (size_t j = 0; j < input_shape.size(); ++j) {
                 //     std::cout << input_shape[j];
@@ -244,6 +254,7 @@ void ONNXInferenceEngine::LoadModel(const std::string& model_path)
                 }
                 
                 output_shapes_.push_back(output_shape);
+                output_types_.push_back(output_shape_info.GetElementType());
                 // std::cout << "[ONNX Engine] Output " << i << ": " << output_names_.back() << " shape: [";
                 // for (size_t j = 0; j < output_shape.size(); ++j) {
                 //     std::cout << output_shape[j];
@@ -286,6 +297,22 @@ void ONNXInferenceEngine::LoadModel(const std::string& model_path)
         //     std::cout << "[ONNX Engine] Output name " << i << ": '" << output_names_char_[i] << "'" << std::endl;
         // }
         
+        selected_outputs_.clear();
+        for (size_t i = 0; i < output_names_.size(); ++i) {
+            selected_outputs_.push_back(i);
+        }
+        selected_output_names_char_ = output_names_char_;
+        run_outputs_.clear();
+
+        if (use_io_binding_) {
+            try {
+                InitIoBinding();
+            } catch (const std::exception& e) {
+                std::cerr << "[ONNX Engine] IoBinding unavailable, using per-call tensors: " << e.what() << std::endl;
+                ReleaseIoBinding();
+            }
+        }
+
         model_loaded_ = true;
         std::cout << "[ONNX Engine] Model loaded successfully" << std::endl;
         
@@ -418,16 +445,17 @@ std::vector<Ort::Value> ONNXInferenceEngine::Forward(const std::vector<float>& o
             input_shapes_[0].size()
         );
 
-        auto input_tensor_time_step = Ort::Value::CreateTensor<float>(
-            memory_info_,
-            time_step_data.data(),
-            time_step_data.size(),
-            input_shapes_[1].data(),
-            input_shapes_[1].size()
-        );
-
         input_tensors.push_back(std::move(input_tensor_obs));
-        input_tensors.push_back(std::move(input_tensor_time_step));
+        // single-input policies take the observation only, as in Run
+        if (input_shapes_.size() > 1) {
+            input_tensors.push_back(Ort::Value::CreateTensor<float>(
+                memory_info_,
+                time_step_data.data(),
+                time_step_data.size(),
+                input_shapes_[1].data(),
+                input_shapes_[1].size()
+            ));
+        }
 
         // Run inference
         auto output_tensors = session_->Run(
@@ -452,6 +480,208 @@ std::vector<Ort::Value> ONNXInferenceEngine::Forward(const std::vector<float>& o
     }
 }
 
+static size_t ElementByteSize(ONNXTensorElementDataType type)
+{
+    switch (type) {
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+            return 1;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT16:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT16:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_BFLOAT16:
+            return 2;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT32:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+            return 4;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT64:
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
+            return 8;
+        default:
+            throw std::runtime_error("Unsupported tensor element type for IoBinding: " + std::to_string(static_cast<int>(type)));
+    }
+}
+
+// Dynamic dimensions are bound as 1, the policies are always run with a batch of one
+static size_t ResolveStaticShape(std::vector<int64_t>& shape)
+{
+    size_t count = 1;
+    for (int64_t& dim : shape) {
+        if (dim <= 0) {
+            dim = 1;
+        }
+        count *= static_cast<size_t>(dim);
+    }
+    return count;
+}
+
+static void* AllocateAligned(size_t bytes)
+{
+    const size_t alignment = 64;
+    size_t padded = (std::max<size_t>(bytes, 1) + alignment - 1) / alignment * alignment;
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, alignment, padded) != 0) {
+        throw std::bad_alloc();
+    }
+    std::memset(ptr, 0, padded);
+    return ptr;
+}
+
+void ONNXInferenceEngine::InitIoBinding()
+{
+    io_binding_ = std::make_unique<Ort::IoBinding>(*session_);
+
+    for (size_t i = 0; i < input_names_.size(); ++i) {
+        if (input_types_[i] != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
+            throw std::runtime_error("IoBinding mode requires float inputs, input '" + input_names_[i] + "' is not");
+        }
+        std::vector<int64_t> shape = input_shapes_[i];
+        size_t count = ResolveStaticShape(shape);
+        bound_input_buffers_.emplace_back(AllocateAligned(count * sizeof(float)));
+        bound_input_sizes_.push_back(count);
+        bound_inputs_.push_back(Ort::Value::CreateTensor<float>(
+            memory_info_,
+            static_cast<float*>(bound_input_buffers_.back().get()),
+            count,
+            shape.data(),
+            shape.size()
+        ));
+        io_binding_->BindInput(input_names_char_[i], bound_inputs_.back());
+    }
+
+    for (size_t i = 0; i < output_names_.size(); ++i) {
+        std::vector<int64_t> shape = output_shapes_[i];
+        size_t count = ResolveStaticShape(shape);
+        size_t bytes = count * ElementByteSize(output_types_[i]);
+        bound_output_buffers_.emplace_back(AllocateAligned(bytes));
+        bound_output_counts_.push_back(count);
+        bound_outputs_.push_back(Ort::Value::CreateTensor(
+            memory_info_,
+            bound_output_buffers_.back().get(),
+            bytes,
+            shape.data(),
+            shape.size(),
+            output_types_[i]
+        ));
+        io_binding_->BindOutput(output_names_char_[i], bound_outputs_.back());
+    }
+}
+
+void ONNXInferenceEngine::ReleaseIoBinding()
+{
+    // Values and binding must go before the buffers they point to
+    io_binding_.reset();
+    bound_inputs_.clear();
+    bound_outputs_.clear();
+    bound_input_buffers_.clear();
+    bound_output_buffers_.clear();
+    bound_input_sizes_.clear();
+    bound_output_counts_.clear();
+}
+
+const std::vector<Ort::Value>& ONNXInferenceEngine::ForwardBound(const float* obs, size_t obs_size, float time_step)
+{
+    if (!model_loaded_) {
+        throw std::runtime_error("Model not loaded");
+    }
+    if (!io_binding_) {
+        throw std::runtime_error("IoBinding mode is not enabled for this model");
+    }
+    if (obs_size != bound_input_sizes_[0]) {
+        throw std::runtime_error("Observation size " + std::to_string(obs_size) + " does not match model input size " + std::to_string(bound_input_sizes_[0]));
+    }
+
+    std::memcpy(bound_input_buffers_[0].get(), obs, obs_size * sizeof(float));
+    if (bound_inputs_.size() > 1) {
+        *static_cast<float*>(bound_input_buffers_[1].get()) = time_step;
+    }
+
+    session_->Run(Ort::RunOptions{nullptr}, *io_binding_);
+    return bound_outputs_;
+}
+
+int ONNXInferenceEngine::FindOutput(const std::string& name) const
+{
+    for (size_t i = 0; i < output_names_.size(); ++i) {
+        if (output_names_[i] == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void ONNXInferenceEngine::SelectOutputs(const std::vector<std::string>& names)
+{
+    if (!model_loaded_) {
+        throw std::runtime_error("Model not loaded");
+    }
+
+    std::vector<size_t> selected;
+    for (const auto& name : names) {
+        int index = FindOutput(name);
+        if (index < 0) {
+            throw std::runtime_error("Model has no output named '" + name + "'");
+        }
+        selected.push_back(static_cast<size_t>(index));
+    }
+
+    selected_outputs_ = selected;
+    selected_output_names_char_.clear();
+    for (size_t index : selected_outputs_) {
+        selected_output_names_char_.push_back(output_names_char_[index]);
+    }
+    run_outputs_.clear();
+
+    if (io_binding_) {
+        io_binding_->ClearBoundOutputs();
+        for (size_t index : selected_outputs_) {
+            io_binding_->BindOutput(output_names_char_[index], bound_outputs_[index]);
+        }
+    }
+}
+
+void ONNXInferenceEngine::Run(const float* obs, size_t obs_size, float time_step)
+{
+    if (io_binding_) {
+        ForwardBound(obs, obs_size, time_step);
+        return;
+    }
+    if (!model_loaded_) {
+        throw std::runtime_error("Model not loaded");
+    }
+
+    float time_step_data = time_step;
+    std::vector<Ort::Value> input_tensors;
+    input_tensors.push_back(Ort::Value::CreateTensor<float>(
+        memory_info_,
+        const_cast<float*>(obs),
+        obs_size,
+        input_shapes_[0].data(),
+        input_shapes_[0].size()
+    ));
+    if (input_shapes_.size() > 1) {
+        input_tensors.push_back(Ort::Value::CreateTensor<float>(
+            memory_info_,
+            &time_step_data,
+            1,
+            input_shapes_[1].data(),
+            input_shapes_[1].size()
+        ));
+    }
+
+    run_outputs_ = session_->Run(
+        Ort::RunOptions{nullptr},
+        input_names_char_.data(),
+        input_tensors.data(),
+        input_tensors.size(),
+        selected_output_names_char_.data(),
+        selected_output_names_char_.size()
+    );
+}
+
 void ONNXInferenceEngine::PrintModelInfo() 
 {
     std::cout << "[ONNX Engine] Model loaded successfully" << std::endl;
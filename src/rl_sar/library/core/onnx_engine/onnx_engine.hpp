@@ -15,6 +15,22 @@
 #include <memory>
 #include <string>
 #include <iostream>
+#include <cstdlib>
+#include <stdexcept>
+
+// Non-owning view over a tensor held by the engine, valid until the next Run
+template <typename T>
+struct TensorView
+{
+    const T* data = nullptr;
+    size_t size = 0;
+
+    const T& operator[](size_t i) const { return data[i]; }
+    const T* begin() const { return data; }
+    const T* end() const { return data + size; }
+    bool empty() const { return size == 0; }
+    TensorView<T> Subview(size_t offset, size_t count) const { return TensorView<T>{data + offset, count}; }
+};
 
 class ONNXInferenceEngine 
 {
@@ -30,6 +46,21 @@ public:
 // #else
     std::vector<Ort::Value> FirstOutput();
 // #endif
+
+    // Bound-session mode: input/output tensors are created once at LoadModel over engine-owned buffers,
+    // ForwardBound only writes the inputs and runs the session. The returned values stay owned by the engine
+    // and are overwritten by the next call.
+    void SetUseIoBinding(bool enable) { use_io_binding_ = enable; }
+    bool IsIoBindingEnabled() const { return use_io_binding_ && io_binding_ != nullptr; }
+    const std::vector<Ort::Value>& ForwardBound(const float* obs, size_t obs_size, float time_step);
+
+    // Output selection. Slots index the outputs in the order passed to SelectOutputs, after LoadModel every
+    // output is selected and a slot equals the model output index. Outputs that are not selected are not fetched.
+    int FindOutput(const std::string& name) const;
+    void SelectOutputs(const std::vector<std::string>& names);
+    void Run(const float* obs, size_t obs_size, float time_step);
+    template <typename T>
+    TensorView<T> GetOutputView(size_t slot) const;
     
     bool IsModelLoaded() const { return model_loaded_; }
     
@@ -44,6 +75,7 @@ public:
     // Get output names for indexing the results
     const std::vector<std::string>& GetOutputNames() const { return output_names_; }
     const std::vector<std::string>& GetInputNames() const { return input_names_; }
+    const std::vector<std::vector<int64_t>>& GetInputShapes() const { return input_shapes_; }
     bool model_loaded_;
 // #endif
     
@@ -61,10 +93,50 @@ private:
     std::vector<const char*> output_names_char_;
     std::vector<std::vector<int64_t>> input_shapes_;
     std::vector<std::vector<int64_t>> output_shapes_;
-    
+    std::vector<ONNXTensorElementDataType> input_types_;
+    std::vector<ONNXTensorElementDataType> output_types_;
+
+    // bound-session mode
+    struct AlignedFree { void operator()(void* ptr) const { std::free(ptr); } };
+    bool use_io_binding_;
+    std::unique_ptr<Ort::IoBinding> io_binding_;
+    std::vector<std::unique_ptr<void, AlignedFree>> bound_input_buffers_;
+    std::vector<std::unique_ptr<void, AlignedFree>> bound_output_buffers_;
+    std::vector<size_t> bound_input_sizes_;
+    std::vector<Ort::Value> bound_inputs_;
+    std::vector<Ort::Value> bound_outputs_;
+    std::vector<size_t> bound_output_counts_;
+    void InitIoBinding();
+    void ReleaseIoBinding();
+
+    // output selection
+    std::vector<size_t> selected_outputs_;
+    std::vector<const char*> selected_output_names_char_;
+    std::vector<Ort::Value> run_outputs_;
+
     void PrintModelInfo();
-#endif
+// #endif
     
 };
 
-// #endif // ONNX_ENGINE_HPP
+template <typename T>
+TensorView<T> ONNXInferenceEngine::GetOutputView(size_t slot) const
+{
+    if (slot >= selected_outputs_.size()) {
+        throw std::out_of_range("Output slot " + std::to_string(slot) + " is not selected");
+    }
+    size_t index = selected_outputs_[slot];
+    if (output_types_[index] != Ort::TypeToTensorType<T>::type) {
+        throw std::runtime_error("Output '" + output_names_[index] + "' requested with the wrong element type");
+    }
+    if (io_binding_) {
+        return TensorView<T>{static_cast<const T*>(bound_output_buffers_[index].get()), bound_output_counts_[index]};
+    }
+    if (slot >= run_outputs_.size()) {
+        throw std::runtime_error("No output available, call Run first");
+    }
+    Ort::Value& value = const_cast<Ort::Value&>(run_outputs_[slot]);
+    return TensorView<T>{value.GetTensorMutableData<T>(), value.GetTensorTypeAndShapeInfo().GetElementCount()};
+}
+
+#endif // ONNX_ENGINE_HPP
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef QUATERNION_HPP
+#define QUATERNION_HPP
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define QUATERNION_HAS_NEON 1
+#else
+#define QUATERNION_HAS_NEON 0
+#endif
+
+/**
+ * Quaternion and rotation kernels on raw arrays, no libtorch and no Eigen.
+ *
+ * Quaternions are 4 values in w, x, y, z order, vectors are 3 values, rotation matrices are 9 values in
+ * row-major order. Batched variants take n quaternions/vectors stored back to back (n x 4 and n x 3, the
+ * layout of a contiguous [n, 4] / [n, 3] tensor); the float versions use NEON on ARM and a plain loop the
+ * compiler can vectorise elsewhere. Output arrays must not alias inputs.
+ */
+namespace quaternion
+{
+
+// out = a * b
+template <typename T>
+inline void Multiply(const T *a, const T *b, T *out)
+{
+    out[0] = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+    out[1] = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+    out[2] = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+    out[3] = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+}
+
+template <typename T>
+inline void Conjugate(const T *q, T *out)
+{
+    out[0] = q[0];
+    out[1] = -q[1];
+    out[2] = -q[2];
+    out[3] = -q[3];
+}
+
+// Rotation of angle radians about a unit axis
+template <typename T>
+inline void FromAxisAngle(const T *axis, T angle, T *out)
+{
+    const T s = std::sin(angle / 2);
+    out[0] = std::cos(angle / 2);
+    out[1] = axis[0] * s;
+    out[2] = axis[1] * s;
+    out[3] = axis[2] * s;
+}
+
+// out = q * v * q^-1 for a unit quaternion:
+// v' = v * (2w^2 - 1) + 2w * (q_vec x v) + 2 * q_vec * (q_vec . v)
+template <typename T>
+inline void Rotate(const T *q, const T *v, T *out)
+{
+    const T w = q[0], x = q[1], y = q[2], z = q[3];
+    const T a = 2 * w * w - 1;
+    const T cx = y * v[2] - z * v[1];
+    const T cy = z * v[0] - x * v[2];
+    const T cz = x * v[1] - y * v[0];
+    const T d = 2 * (x * v[0] + y * v[1] + z * v[2]);
+    out[0] = v[0] * a + cx * w * 2 + x * d;
+    out[1] = v[1] * a + cy * w * 2 + y * d;
+    out[2] = v[2] * a + cz * w * 2 + z * d;
+}
+
+// out = q^-1 * v * q, the world-frame vector v expressed in the body frame of q (projected gravity etc.)
+template <typename T>
+inline void RotateInverse(const T *q, const T *v, T *out)
+{
+    const T w = q[0], x = q[1], y = q[2], z = q[3];
+    const T a = 2 * w * w - 1;
+    const T cx = y * v[2] - z * v[1];
+    const T cy = z * v[0] - x * v[2];
+    const T cz = x * v[1] - y * v[0];
+    const T d = 2 * (x * v[0] + y * v[1] + z * v[2]);
+    out[0] = v[0] * a - cx * w * 2 + x * d;
+    out[1] = v[1] * a - cy * w * 2 + y * d;
+    out[2] = v[2] * a - cz * w * 2 + z * d;
+}
+
+template <typename T>
+inline void ToRotationMatrix(const T *q, T *r)
+{
+    const T w = q[0], x = q[1], y = q[2], z = q[3];
+    r[0] = 1 - 2 * (y * y + z * z);
+    r[1] = 2 * (x * y - w * z);
+    r[2] = 2 * (x * z + w * y);
+    r[3] = 2 * (x * y + w * z);
+    r[4] = 1 - 2 * (x * x + z * z);
+    r[5] = 2 * (y * z - w * x);
+    r[6] = 2 * (x * z - w * y);
+    r[7] = 2 * (y * z + w * x);
+    r[8] = 1 - 2 * (x * x + y * y);
+}
+
+// First two columns of a rotation matrix, row by row: r00 r01 r10 r11 r20 r21
+template <typename T>
+inline void MatrixToRot6d(const T *r, T *out)
+{
+    out[0] = r[0];
+    out[1] = r[1];
+    out[2] = r[3];
+    out[3] = r[4];
+    out[4] = r[6];
+    out[5] = r[7];
+}
+
+template <typename T>
+inline void ToRot6d(const T *q, T *out)
+{
+    T r[9];
+    ToRotationMatrix(q, r);
+    MatrixToRot6d(r, out);
+}
+
+// Heading angle, read straight from the quaternion so it has no gimbal-lock discontinuity:
+// yaw = atan2(2 (w z + x y), 1 - 2 (y^2 + z^2))
+template <typename T>
+inline T Yaw(const T *q)
+{
+    return std::atan2(2 * (q[0] * q[3] + q[1] * q[2]), 1 - 2 * (q[2] * q[2] + q[3] * q[3]));
+}
+
+// Rotation about z by the heading of q
+template <typename T>
+inline void YawQuat(const T *q, T *out)
+{
+    const T yaw = Yaw(q);
+    out[0] = std::cos(yaw / 2);
+    out[1] = 0;
+    out[2] = 0;
+    out[3] = std::sin(yaw / 2);
+}
+
+template <typename T>
+inline void YawMatrix(const T *q, T *r)
+{
+    const T yaw = Yaw(q);
+    const T c = std::cos(yaw), s = std::sin(yaw);
+    r[0] = c;  r[1] = -s; r[2] = 0;
+    r[3] = s;  r[4] = c;  r[5] = 0;
+    r[6] = 0;  r[7] = 0;  r[8] = 1;
+}
+
+// Roll about x and pitch about y in radians (ZYX convention), pitch saturates at +-pi/2
+template <typename T>
+inline void RollPitch(const T *q, T *roll, T *pitch)
+{
+    const T w = q[0], x = q[1], y = q[2], z = q[3];
+    *roll = std::atan2(2 * (w * x + y * z), 1 - 2 * (x * x + y * y));
+    const T sinp = 2 * (w * y - z * x);
+    *pitch = std::fabs(sinp) >= 1 ? std::copysign(static_cast<T>(M_PI / 2), sinp) : std::asin(sinp);
+}
+
+template <typename T>
+inline void RotateBatch(const T *q, const T *v, T *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        Rotate(q + 4 * i, v + 3 * i, out + 3 * i);
+}
+
+template <typename T>
+inline void RotateInverseBatch(const T *q, const T *v, T *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        RotateInverse(q + 4 * i, v + 3 * i, out + 3 * i);
+}
+
+template <typename T>
+inline void YawBatch(const T *q, T *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = Yaw(q + 4 * i);
+}
+
+template <typename T>
+inline void ToRot6dBatch(const T *q, T *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        ToRot6d(q + 4 * i, out + 6 * i);
+}
+
+template <typename T>
+inline void RollPitchBatch(const T *q, T *roll, T *pitch, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        RollPitch(q + 4 * i, roll + i, pitch + i);
+}
+
+#if QUATERNION_HAS_NEON
+namespace detail
+{
+// Four rotations at once on deinterleaved lanes, sign = +1 rotates, -1 inverse-rotates
+inline float32x4x3_t RotateLanes(const float32x4x4_t &q, const float32x4x3_t &v, float sign)
+{
+    const float32x4_t w = q.val[0], x = q.val[1], y = q.val[2], z = q.val[3];
+    const float32x4_t a = vsubq_f32(vmulq_n_f32(vmulq_f32(w, w), 2.0f), vdupq_n_f32(1.0f));
+    const float32x4_t cx = vmlsq_f32(vmulq_f32(y, v.val[2]), z, v.val[1]);
+    const float32x4_t cy = vmlsq_f32(vmulq_f32(z, v.val[0]), x, v.val[2]);
+    const float32x4_t cz = vmlsq_f32(vmulq_f32(x, v.val[1]), y, v.val[0]);
+    const float32x4_t d = vmulq_n_f32(vmlaq_f32(vmlaq_f32(vmulq_f32(x, v.val[0]), y, v.val[1]), z, v.val[2]), 2.0f);
+    const float32x4_t w2 = vmulq_n_f32(w, 2.0f * sign);
+    float32x4x3_t out;
+    out.val[0] = vmlaq_f32(vmlaq_f32(vmulq_f32(v.val[0], a), cx, w2), x, d);
+    out.val[1] = vmlaq_f32(vmlaq_f32(vmulq_f32(v.val[1], a), cy, w2), y, d);
+    out.val[2] = vmlaq_f32(vmlaq_f32(vmulq_f32(v.val[2], a), cz, w2), z, d);
+    return out;
+}
+} // namespace detail
+
+template <>
+inline void RotateBatch<float>(const float *q, const float *v, float *out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        vst3q_f32(out + 3 * i, detail::RotateLanes(vld4q_f32(q + 4 * i), vld3q_f32(v + 3 * i), 1.0f));
+    for (; i < n; ++i)
+        Rotate(q + 4 * i, v + 3 * i, out + 3 * i);
+}
+
+template <>
+inline void RotateInverseBatch<float>(const float *q, const float *v, float *out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        vst3q_f32(out + 3 * i, detail::RotateLanes(vld4q_f32(q + 4 * i), vld3q_f32(v + 3 * i), -1.0f));
+    for (; i < n; ++i)
+        RotateInverse(q + 4 * i, v + 3 * i, out + 3 * i);
+}
+
+template <>
+inline void ToRot6dBatch<float>(const float *q, float *out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const float32x4x4_t qv = vld4q_f32(q + 4 * i);
+        const float32x4_t w = qv.val[0], x = qv.val[1], y = qv.val[2], z = qv.val[3];
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        float32x4_t r[6];
+        r[0] = vmlsq_n_f32(one, vmlaq_f32(vmulq_f32(y, y), z, z), 2.0f);   // r00
+        r[1] = vmulq_n_f32(vmlsq_f32(vmulq_f32(x, y), w, z), 2.0f);         // r01
+        r[2] = vmulq_n_f32(vmlaq_f32(vmulq_f32(x, y), w, z), 2.0f);         // r10
+        r[3] = vmlsq_n_f32(one, vmlaq_f32(vmulq_f32(x, x), z, z), 2.0f);   // r11
+        r[4] = vmulq_n_f32(vmlsq_f32(vmulq_f32(x, z), w, y), 2.0f);         // r20
+        r[5] = vmulq_n_f32(vmlaq_f32(vmulq_f32(y, z), w, x), 2.0f);         // r21
+        float lanes[6][4];
+        for (int k = 0; k < 6; ++k)
+            vst1q_f32(lanes[k], r[k]);
+        for (int j = 0; j < 4; ++j)
+            for (int k = 0; k < 6; ++k)
+                out[6 * (i + j) + k] = lanes[k][j];
+    }
+    for (; i < n; ++i)
+        ToRot6d(q + 4 * i, out + 6 * i);
+}
+#endif
+
+} // namespace quaternion
+
+#endif // QUATERNION_HPP
@@ -8,210 +8,276 @@
 #include <fstream>
 #include <ostream>
 #include <vector>
+#include <cmath>
+#include <cstring>
 #include <Eigen/Dense>
 #include <Eigen/Geometry>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <tbb/parallel_for.h>
 
 void RL::StateController(const RobotState<double>* state, RobotCommand<double>* command)
 {
-    auto updateState = [&](std::shared_ptr<FSMState> statePtr)
+    if (state != this->fsm_bound_state || command != this->fsm_bound_command)
     {
-        if (auto rl_fsm_state = std::dynamic_pointer_cast<RLFSMState>(statePtr))
+        this->BindFSMBuffers(state, command);
+    }
+
+    fsm.Run();
+}
+
+void RL::BindFSMBuffers(const RobotState<double>* state, RobotCommand<double>* command)
+{
+    for (const auto& fsm_state : this->fsm.GetStates())
+    {
+        if (auto rl_fsm_state = std::dynamic_pointer_cast<RLFSMState>(fsm_state))
         {
             rl_fsm_state->fsm_state = state;
             rl_fsm_state->fsm_command = command;
         }
-    };
-    for (auto& pair : fsm.states_)
-    {
-        updateState(pair.second);
     }
-
-    fsm.Run();
+    this->fsm_bound_state = state;
+    this->fsm_bound_command = command;
 }
 
 
 
+template <size_t N>
+static void CopyArrayData(float *dst, const std::array<double, N> &src, int size, float scale = 1.0f)
+{
+    for (int i = 0; i < size; ++i) dst[i] = static_cast<float>(src[i]) * scale;
+}
+
+static void CopyTensorData(float *dst, const torch::Tensor &src, int size)
+{
+    // Fast path for the contiguous float tensors preallocated per policy
+    if (src.scalar_type() == torch::kFloat32 && src.is_contiguous())
+    {
+        std::memcpy(dst, src.data_ptr<float>(), size * sizeof(float));
+        return;
+    }
+    torch::Tensor contiguous = src.to(torch::kFloat32).contiguous();
+    std::memcpy(dst, contiguous.data_ptr<float>(), size * sizeof(float));
+}
+
 torch::Tensor RL::ComputeObservation()
 {
-    std::vector<torch::Tensor> obs_list;
+    // Every term is written from the raw per-tick state straight into the preallocated obs_data buffer at the
+    // offset resolved by InitObservationPlan, obs_tensor is a view over the same memory so nothing is allocated here.
+    float *obs_base = this->obs_data.data();
+    const float motion_time = this->episode_length_buf * this->policy_params.dt * this->policy_params.decimation;
 
-    for (const std::string &observation : this->params.observations)
+    for (const ObservationPlanEntry &entry : this->obs_plan)
     {
-        if (observation == "lin_vel")
-        {
-            obs_list.push_back(this->obs.lin_vel * this->params.lin_vel_scale);
-        }
-        else if (observation == "ang_vel_body")
-        {
-            // std::cout << "ang_vel_body_scale: " << this->params.ang_vel_scale << std::endl;
-            obs_list.push_back(this->obs.ang_vel * this->params.ang_vel_scale);
-        }
-        else if (observation == "ang_vel_world")
+        float *dst = obs_base + entry.offset;
+        switch (entry.term)
         {
-            obs_list.push_back(this->QuatRotateInverse(this->obs.base_quat, this->obs.ang_vel) );
-        }
-        else if (observation == "gravity_vec")
-        {
-            obs_list.push_back(this->QuatRotateInverse(this->obs.base_quat, this->obs.gravity_vec));
-        }
-        else if (observation == "commands")
-        {
-            obs_list.push_back(this->obs.commands * this->params.commands_scale);
-        }
-        else if (observation == "dof_pos")
+        case ObservationTerm::LinVel:
+            CopyArrayData(dst, this->obs.lin_vel, entry.dims, entry.scale);
+            break;
+        case ObservationTerm::AngVelBody:
+            CopyArrayData(dst, this->obs.ang_vel, entry.dims, entry.scale);
+            break;
+        case ObservationTerm::AngVelWorld:
+        case ObservationTerm::GravityVec:
         {
-            torch::Tensor dof_pos_rel = this->obs.dof_pos - this->params.default_dof_pos;
-            for (int i : this->params.wheel_indices)
-            {
-                dof_pos_rel[0][i] = 0.0;
-            }
-            // std::cout << "dof_pos_scale: " << this->params.dof_pos_scale << std::endl;
-            obs_list.push_back(dof_pos_rel);
+            float q[4], v[3];
+            CopyArrayData(q, this->obs.base_quat, 4);
+            CopyArrayData(v, entry.term == ObservationTerm::GravityVec ? this->obs.gravity_vec : this->obs.ang_vel, 3);
+            quaternion::RotateInverse(q, v, dst);
+            break;
         }
-        else if (observation == "dof_vel")
+        case ObservationTerm::Commands:
+            CopyArrayData(dst, this->obs.commands, entry.dims);
+            for (int i = 0; i < entry.dims; ++i) dst[i] *= entry.commands_scale[i];
+            break;
+        case ObservationTerm::DofPos:
         {
-            // std::cout << "vel_scale: " << this->params.dof_vel_scale << std::endl;
-            obs_list.push_back(this->obs.dof_vel);
+            const std::array<double, ModelParams::kMaxDofs> &default_dof_pos = this->policy_params.joint.default_dof_pos;
+            for (int i = 0; i < entry.dims; ++i) dst[i] = static_cast<float>(this->obs.dof_pos[i] - default_dof_pos[i]);
+            for (int i : this->policy_params.wheel_indices) dst[i] = 0.0f;
+            break;
         }
-        else if (observation == "actions")
+        case ObservationTerm::DofVel:
+            CopyArrayData(dst, this->obs.dof_vel, entry.dims);
+            break;
+        case ObservationTerm::Actions:
+            CopyTensorData(dst, this->obs.actions, entry.dims);
+            break;
+        case ObservationTerm::Phase:
         {
-            obs_list.push_back(this->obs.actions);
+            float phase = 3.1415926f * motion_time / 2;
+            dst[0] = std::sin(phase);
+            dst[1] = std::cos(phase);
+            dst[2] = std::sin(phase / 2);
+            dst[3] = std::cos(phase / 2);
+            dst[4] = std::sin(phase / 4);
+            dst[5] = std::cos(phase / 4);
+            break;
         }
-        else if (observation == "phase")
+        case ObservationTerm::G1Phase:
         {
-            float motion_time = this->episode_length_buf * this->params.dt * this->params.decimation;
-            torch::Tensor phase = torch::tensor({{3.1415926 * motion_time / 2}});
-            torch::Tensor phase_tensor = torch::cat({
-                torch::sin(phase),
-                torch::cos(phase),
-                torch::sin(phase / 2),
-                torch::cos(phase / 2),
-                torch::sin(phase / 4),
-                torch::cos(phase / 4),
-            }, -1);
-            obs_list.push_back(phase_tensor);
+            float phase = std::fmod(motion_time, 0.8f) / 0.8f;
+            dst[0] = std::sin(2 * 3.1415926f * phase);
+            dst[1] = std::cos(2 * 3.1415926f * phase);
+            break;
         }
-        else if (observation == "g1_phase")
-        {
-            float motion_time = this->episode_length_buf * this->params.dt * this->params.decimation;
-            torch::Tensor period = torch::tensor({{0.8f}});
-            torch::Tensor count = torch::tensor({{motion_time}});
-            torch::Tensor phase = torch::fmod(count, period) / period;
-            torch::Tensor phase_tensor = torch::cat({
-                torch::sin(2 * 3.1415926f * phase),
-                torch::cos(2 * 3.1415926f * phase),
-            }, -1);
-            obs_list.push_back(phase_tensor);
+        case ObservationTerm::G1MimicPhase:
+            dst[0] = motion_time / this->motion_length;
+            break;
+        case ObservationTerm::CommandsMotionPos:
+            CopyTensorData(dst, this->ref_joint_pos, entry.dims);
+            break;
+        case ObservationTerm::CommandsMotionVel:
+            CopyTensorData(dst, this->ref_joint_vel, entry.dims);
+            break;
+        case ObservationTerm::MotionAnchorOriB:
+            this->ComputeMotionAnchorOriB(dst);
+            break;
         }
-        else if (observation == "g1_mimic_phase")
-        {
-            float motion_time = this->episode_length_buf * this->params.dt * this->params.decimation;
-            torch::Tensor count = torch::tensor({{motion_time}});
-            torch::Tensor phase = count / this->motion_length;
-            obs_list.push_back(phase);
-        }
-        else if (observation == "commands_motion")
+    }
+
+    return this->obs_tensor;
+}
+
+void RL::ComputeMotionAnchorOriB(float *dst)
+{
+    // Torso orientation is the pelvis IMU followed by the waist yaw (z), roll (x) and pitch (y) joints. Read from
+    // the per-tick copies in obs, robot_state is rewritten by the control loop while the model runs.
+    const std::array<double, ROBOT_MAX_DOFS> &dof_pos = this->obs.dof_pos;
+    const double waist_yaw[4] = {std::cos(dof_pos[kWaistYawIndex] / 2), 0.0, 0.0, std::sin(dof_pos[kWaistYawIndex] / 2)};
+    const double waist_roll[4] = {std::cos(dof_pos[kWaistRollIndex] / 2), std::sin(dof_pos[kWaistRollIndex] / 2), 0.0, 0.0};
+    const double waist_pitch[4] = {std::cos(dof_pos[kWaistPitchIndex] / 2), 0.0, std::sin(dof_pos[kWaistPitchIndex] / 2), 0.0};
+    double waist_yaw_roll[4], waist[4], torso[4];
+    quaternion::Multiply(waist_yaw, waist_roll, waist_yaw_roll);
+    quaternion::Multiply(waist_yaw_roll, waist_pitch, waist);
+    quaternion::Multiply(this->obs.base_quat.data(), waist, torso);
+
+    if (this->calc_anchor_called < 2)
+    {
+        Eigen::Matrix<double, 3, 3, Eigen::RowMajor> init_to_anchor, world_to_anchor;
+        quaternion::YawMatrix(this->ref_anchor_quat.data(), init_to_anchor.data());
+        quaternion::YawMatrix(torso, world_to_anchor.data());
+        this->init_to_world = world_to_anchor * init_to_anchor.transpose();
+        this->calc_anchor_called ++;
+    }
+
+    // torso^T * init_to_world * ref, only the two columns that make up the rot6d term are formed
+    Eigen::Matrix<double, 3, 3, Eigen::RowMajor> torso_rot, ref_rot;
+    quaternion::ToRotationMatrix(torso, torso_rot.data());
+    quaternion::ToRotationMatrix(this->ref_anchor_quat.data(), ref_rot.data());
+    const Eigen::Matrix<double, 3, 2> anchor = torso_rot.transpose() * (this->init_to_world * ref_rot.leftCols<2>());
+    dst[0] = static_cast<float>(anchor(0, 0));
+    dst[1] = static_cast<float>(anchor(0, 1));
+    dst[2] = static_cast<float>(anchor(1, 0));
+    dst[3] = static_cast<float>(anchor(1, 1));
+    dst[4] = static_cast<float>(anchor(2, 0));
+    dst[5] = static_cast<float>(anchor(2, 1));
+}
+
+int RL::BuildObservationPlan(const ModelParams &params, std::vector<ObservationPlanEntry> &plan)
+{
+    plan.clear();
+
+    // Converted here once, ComputeObservation does not touch the tensor
+    std::array<float, 3> commands_scale{{1.0f, 1.0f, 1.0f}};
+    if (params.commands_scale.defined() && params.commands_scale.numel() != 0)
+    {
+        if (params.commands_scale.numel() != 3)
         {
-            obs_list.push_back(this->ref_joint_pos);
-            obs_list.push_back(this->ref_joint_vel);
+            throw std::runtime_error("commands_scale has " + std::to_string(params.commands_scale.numel()) + " values, expected 3");
         }
-        else if (observation == "motion_anchor_ori_b")
-        {
-            // Use efficient quaternion utils for computation
-            // std::cout << "torso quat: " << this->obs.base_quat << std::endl;
-            // std::cout << "pelvis quat: " << this->obs.base_quat << std::endl;
-            torso_quat = Eigen::Quaterniond(this->obs.base_quat[0][0].item<double>(),
-                                            this->obs.base_quat[0][1].item<double>(),
-                                            this->obs.base_quat[0][2].item<double>(),
-                                            this->obs.base_quat[0][3].item<double>());
-            double waist_yaw = this->obs.dof_pos[0][2].item<double>();
-            double waist_roll = this->obs.dof_pos[0][5].item<double>();
-            double waist_pitch = this->obs.dof_pos[0][8].item<double>();
-            Eigen::Quaterniond base_torso_yaw(Eigen::AngleAxisd(waist_yaw, Eigen::Vector3d::UnitZ()));
-            Eigen::Quaterniond base_torso_roll(Eigen::AngleAxisd(waist_roll, Eigen::Vector3d::UnitX()));
-            Eigen::Quaterniond base_torso_pitch(Eigen::AngleAxisd(waist_pitch, Eigen::Vector3d::UnitY()));
-            torso_quat = torso_quat * base_torso_yaw * base_torso_roll * base_torso_pitch;
-
-            ref_motion_quat = Eigen::Quaterniond(this->ref_body_quat_w[0][0].item<double>(),
-                                                                this->ref_body_quat_w[0][1].item<double>(),
-                                                                this->ref_body_quat_w[0][2].item<double>(),
-                                                                this->ref_body_quat_w[0][3].item<double>());
-
-            if (this->calc_anchor_called < 2)
-            {
-                auto init_to_anchor = this->YawQuaternion(ref_motion_quat);
-                auto world_to_anchor = this->YawQuaternion(torso_quat);
-                this->init_to_world = world_to_anchor * init_to_anchor.transpose();
-                std::cout << std::setprecision(6);
-                std::cout << "init_to_anchor: "<< init_to_anchor << std::endl;
-                std::cout << "world_to_anchor: " << world_to_anchor << std::endl;
-                std::cout << "init_to_world: " << this->init_to_world << std::endl;
-                this->calc_anchor_called ++;
-            }
+        torch::Tensor values = params.commands_scale.to(torch::kFloat32).contiguous().view(-1);
+        std::copy(values.data_ptr<float>(), values.data_ptr<float>() + 3, commands_scale.begin());
+    }
 
-            motion_anchor_ori_b = torso_quat.toRotationMatrix().transpose() * this->init_to_world * ref_motion_quat.toRotationMatrix();
-            motion_anchor_ori_b_mat = this->VectorToTensor(std::vector<float>{
-                motion_anchor_ori_b(0,0), motion_anchor_ori_b(0,1),
-                motion_anchor_ori_b(1,0), motion_anchor_ori_b(1,1),
-                motion_anchor_ori_b(2,0), motion_anchor_ori_b(2,1)
-            }, {1, 6});
-            // std::cout << "motion_anchor_ori_b_mat: " << motion_anchor_ori_b_mat << std::endl;
+    int offset = 0;
+    auto add_entry = [&](ObservationTerm term, const char *name, int dims, float scale)
+    {
+        plan.push_back({term, name, offset, dims, scale, commands_scale});
+        offset += dims;
+    };
 
-            obs_list.push_back(motion_anchor_ori_b_mat);
+    for (const std::string &observation : params.observations)
+    {
+        if (observation == "lin_vel") add_entry(ObservationTerm::LinVel, "lin_vel", 3, params.lin_vel_scale);
+        else if (observation == "ang_vel_body") add_entry(ObservationTerm::AngVelBody, "ang_vel_body", 3, params.ang_vel_scale);
+        else if (observation == "ang_vel_world") add_entry(ObservationTerm::AngVelWorld, "ang_vel_world", 3, 1.0f);
+        else if (observation == "gravity_vec") add_entry(ObservationTerm::GravityVec, "gravity_vec", 3, 1.0f);
+        else if (observation == "commands") add_entry(ObservationTerm::Commands, "commands", 3, 1.0f);
+        else if (observation == "dof_pos") add_entry(ObservationTerm::DofPos, "dof_pos", params.num_of_dofs, 1.0f);
+        else if (observation == "dof_vel") add_entry(ObservationTerm::DofVel, "dof_vel", params.num_of_dofs, 1.0f);
+        else if (observation == "actions") add_entry(ObservationTerm::Actions, "actions", params.num_of_dofs, 1.0f);
+        else if (observation == "phase") add_entry(ObservationTerm::Phase, "phase", 6, 1.0f);
+        else if (observation == "g1_phase") add_entry(ObservationTerm::G1Phase, "g1_phase", 2, 1.0f);
+        else if (observation == "g1_mimic_phase") add_entry(ObservationTerm::G1MimicPhase, "g1_mimic_phase", 1, 1.0f);
+        else if (observation == "commands_motion")
+        {
+            // reference joint position and velocity, one value per dof
+            add_entry(ObservationTerm::CommandsMotionPos, "commands_motion.pos", params.num_of_dofs, 1.0f);
+            add_entry(ObservationTerm::CommandsMotionVel, "commands_motion.vel", params.num_of_dofs, 1.0f);
         }
+        else if (observation == "motion_anchor_ori_b") add_entry(ObservationTerm::MotionAnchorOriB, "motion_anchor_ori_b", 6, 1.0f);
         else
         {
-            std::cerr << "[RL_SDK] Warning: Unknown observation type '" << observation << "'" << std::endl;
+            throw std::runtime_error("Unknown observation type '" + observation + "'");
         }
     }
+    return offset;
+}
 
+void RL::InitObservationPlan(PolicyState &state)
+{
+    int num_obs = BuildObservationPlan(state.policy_params, state.obs_plan);
+    state.obs_dims.clear();
+    for (const ObservationPlanEntry &entry : state.obs_plan)
+    {
+        state.obs_dims.push_back(entry.dims);
+    }
+
+    // obs_tensor views the vector's heap buffer, which stays put when the vector is swapped into RL
+    state.obs_data.assign(num_obs, 0.0f);
+    state.obs_tensor = torch::from_blob(state.obs_data.data(), {1, num_obs}, torch::TensorOptions().dtype(torch::kFloat32));
 
-    this->obs_dims.clear();
-    for (const auto& obs : obs_list)
+    if (num_obs != state.policy_params.num_observations)
     {
-       this->obs_dims.push_back(obs.size(1));
+        std::cout << LOGGER::WARNING << "Observation layout has " << num_obs << " values but num_observations is " << state.policy_params.num_observations << std::endl;
+        PrintObservationPlan(state.obs_plan, state.obs_data.size());
     }
+}
 
-    torch::Tensor obs = torch::cat(obs_list, 1);
-    torch::Tensor clamped_obs = torch::clamp(obs, -this->params.clip_obs, this->params.clip_obs);
-    return obs;
+void RL::PrintObservationPlan(const std::vector<ObservationPlanEntry> &plan, size_t num_obs)
+{
+    std::cout << LOGGER::INFO << "Observation plan: " << plan.size() << " entries, " << num_obs << " values" << std::endl;
+    for (size_t i = 0; i < plan.size(); ++i)
+    {
+        const ObservationPlanEntry &entry = plan[i];
+        std::cout << "  [" << i << "] " << std::left << std::setw(22) << entry.name << std::right
+                  << " offset: " << std::setw(4) << entry.offset
+                  << " dims: " << std::setw(3) << entry.dims
+                  << " scale: " << entry.scale << std::endl;
+    }
 }
 
-Eigen::Matrix3d RL::YawQuaternion(const Eigen::Quaterniond& q) {
-    // 直接从四元数提取yaw角度，避免欧拉角转换的不连续性问题
-    // yaw = atan2(2*(w*z + x*y), 1 - 2*(y^2 + z^2))
-    double yaw = std::atan2(2.0 * (q.w() * q.z() + q.x() * q.y()),
-                           1.0 - 2.0 * (q.y() * q.y() + q.z() * q.z()));
-    
-    Eigen::AngleAxisd yawAngle(yaw, Eigen::Vector3d::UnitZ());
-    return yawAngle.toRotationMatrix();
-}
-
-void RL::InitObservations()
-{
-    this->obs.lin_vel = torch::tensor({{0.0, 0.0, 0.0}});
-    this->obs.ang_vel = torch::tensor({{0.0, 0.0, 0.0}});
-    this->obs.gravity_vec = torch::tensor({{0.0, 0.0, -1.0}});
-    this->obs.commands = torch::tensor({{0.0, 0.0, 0.0}});
-    this->obs.base_quat = torch::tensor({{1.0, 0.0, 0.0, 0.0}});
-    this->obs.torso_quat = torch::tensor({{1.0, 0.0, 0.0, 0.0}});
-    this->obs.dof_pos = this->params.default_dof_pos;
-    this->obs.dof_vel = torch::zeros({1, this->params.num_of_dofs});
-    this->obs.actions = torch::zeros({1, this->params.num_of_dofs});
-    this->ref_joint_pos = torch::zeros({1, this->params.num_of_dofs});
-    this->ref_joint_vel = torch::zeros({1, this->params.num_of_dofs});
-    this->ref_body_quat_w = torch::tensor({{1.0, 0.0, 0.0, 0.0}});
-    this->init_to_world = Eigen::Matrix3d::Identity();
-    this->motion_anchor_ori_b = Eigen::Matrix3d::Identity();
-    this->motion_anchor_ori_b_mat = torch::tensor({{1.0, 0.0, 0.0, 1.0, 0.0, 0.0}});
-    this->calc_anchor_called = 0;
-    this->ComputeObservation();
+void RL::InitObservations(PolicyState &state)
+{
+    const ModelParams &params = state.policy_params;
+    state.obs = Observations();
+    state.obs.dof_pos = params.joint.default_dof_pos;
+    state.obs.actions = torch::zeros({1, params.num_of_dofs});
+    state.ref_joint_pos = torch::zeros({1, params.num_of_dofs});
+    state.ref_joint_vel = torch::zeros({1, params.num_of_dofs});
+    state.ref_anchor_quat = {{1.0, 0.0, 0.0, 0.0}};
+
+    // Resolve the observation terms once, ComputeObservation only walks the plan afterwards
+    InitObservationPlan(state);
 }
 
 void RL::InitOutputs()
 {
     this->output_dof_tau = torch::zeros({1, this->params.num_of_dofs});
-    this->output_dof_pos = this->params.default_dof_pos;
+    this->output_dof_pos = this->params.default_dof_pos.clone();
     this->output_dof_vel = torch::zeros({1, this->params.num_of_dofs});
 }
 
@@ -224,9 +290,139 @@ void RL::InitControl()
 
 void RL::InitRL(std::string robot_path)
 {
+    // Prepared by the FSM off the control loop. Without that, or when an abandoned prepare replaced it meanwhile,
+    // it is built here, which allocates and may load from disk on the calling thread.
+    std::shared_ptr<PolicyState> state = std::atomic_exchange(&this->prepared_policy_state, std::shared_ptr<PolicyState>());
+    if (!state || state->policy->robot_path != robot_path)
+    {
+        state = this->LoadPolicyState(robot_path);
+    }
+    this->SwitchPolicy(state);
+}
+
+std::shared_ptr<PolicyState> RL::LoadPolicyState(const std::string &robot_path)
+{
+    std::shared_ptr<PolicyBundle> policy = this->policy_registry.Get(robot_path);
+    if (!policy)
+    {
+        // Not preloaded or the preload failed, load it now and keep it for the next switch
+        policy = this->LoadPolicy(robot_path);
+        this->policy_registry.Add(policy);
+    }
+    return BuildPolicyState(policy);
+}
+
+void RL::PreparePolicy(const std::string &robot_path)
+{
+    // What the model loop swapped out at the last switch is freed here rather than on a real-time loop
+    std::atomic_store(&this->retired_policy_state, std::shared_ptr<PolicyState>());
+    std::atomic_store(&this->prepared_policy_state, this->LoadPolicyState(robot_path));
+}
+
+bool RL::IsPolicyPrepared(const std::string &robot_path) const
+{
+    std::shared_ptr<PolicyState> state = std::atomic_load(&this->prepared_policy_state);
+    return state && state->policy->robot_path == robot_path;
+}
+
+std::shared_ptr<PolicyState> RL::BuildPolicyState(const std::shared_ptr<PolicyBundle> &policy)
+{
+    auto state = std::make_shared<PolicyState>();
+    state->policy = policy;
+    state->params = policy->params;
+    state->policy_params = policy->params;
+
+    // Only handles are copied here, the sessions and modules stay owned by the bundle
+    state->model = policy->model;
+    state->pytorch_model_loaded = policy->pytorch_model_loaded;
+    state->onnx_engine = policy->onnx_engine;
+    state->onnx_motion_outputs = policy->onnx_motion_outputs;
+
+    const ModelParams &params = state->policy_params;
+    InitObservations(*state);
+    // Owned copies, ComputeOutput writes into them in place
+    state->output_dof_tau = torch::zeros({1, params.num_of_dofs});
+    state->output_dof_pos = params.default_dof_pos.clone();
+    state->output_dof_vel = torch::zeros({1, params.num_of_dofs});
+
+    // A history of its own, copies of an ObservationBuffer share the storage
+    if (!params.observations_history.empty())
+    {
+        state->history_obs_buf = MakeHistoryBuffer(params, state->obs_dims);
+        state->history_obs = torch::zeros({1, state->history_obs_buf.obs_vec_size()});
+    }
+
+    // UpdateMotionReference writes into these, keep the bundle copy at time step 0
+    if (state->onnx_motion_outputs)
+    {
+        state->ref_joint_pos = policy->ref_joint_pos.clone();
+        state->ref_joint_vel = policy->ref_joint_vel.clone();
+        state->ref_anchor_quat = policy->ref_anchor_quat;
+    }
+    return state;
+}
+
+void RL::PreloadPolicies(const std::vector<std::string> &config_names)
+{
+    std::vector<std::string> robot_paths;
+    for (const std::string &config_name : config_names)
+    {
+        robot_paths.push_back(this->robot_name + "/" + config_name);
+    }
+    this->policy_registry.Preload(robot_paths, [this](const std::string &robot_path) { return this->LoadPolicy(robot_path); });
+}
+
+ObservationBuffer RL::MakeHistoryBuffer(const ModelParams &params, const std::vector<int> &obs_dims)
+{
+    int history_length = *std::max_element(params.observations_history.begin(), params.observations_history.end()) + 1;
+    ObservationBuffer buffer(1, obs_dims, history_length, params.observations_history_priority);
+    buffer.set_obs_ids(params.observations_history);
+    return buffer;
+}
+
+// Reference motion at time step 0 of a BeyondMimic export, outputs are looked up by name. UpdateMotionReference
+// copies joint_pos/joint_vel into the tensors sized here on every step, so their sizes are checked once at load.
+static void InitMotionReference(ONNXInferenceEngine &engine, PolicyBundle &policy)
+{
+    const int num_of_dofs = policy.params.num_of_dofs;
+    auto outputs = engine.FirstOutput();
+    auto joint_pos = ONNXInferenceEngine::ExtractTensorData(outputs[engine.FindOutput("joint_pos")]);
+    auto joint_vel = ONNXInferenceEngine::ExtractTensorData(outputs[engine.FindOutput("joint_vel")]);
+    auto body_quat_w = ONNXInferenceEngine::ExtractTensorData(outputs[engine.FindOutput("body_quat_w")]);
+
+    if (joint_pos.size() != static_cast<size_t>(num_of_dofs) || joint_vel.size() != static_cast<size_t>(num_of_dofs))
+    {
+        throw std::runtime_error("Model " + policy.params.model_name + " outputs " + std::to_string(joint_pos.size()) + " joint_pos and " +
+                                 std::to_string(joint_vel.size()) + " joint_vel values but num_of_dofs is " + std::to_string(num_of_dofs));
+    }
+    if (body_quat_w.size() < 32)
+    {
+        throw std::runtime_error("Model " + policy.params.model_name + " outputs " + std::to_string(body_quat_w.size()) +
+                                 " body_quat_w values, the anchor body quaternion is read from values 28..31");
+    }
+
+    policy.ref_joint_pos = torch::from_blob(joint_pos.data(), {1, num_of_dofs}, torch::kFloat32).clone();
+    policy.ref_joint_vel = torch::from_blob(joint_vel.data(), {1, num_of_dofs}, torch::kFloat32).clone();
+    std::copy(body_quat_w.begin() + 28, body_quat_w.begin() + 32, policy.ref_anchor_quat.begin());
+}
+
+std::shared_ptr<PolicyBundle> RL::LoadPolicy(const std::string &robot_path)
+{
+    // Runs on the control loop when a policy is not preloaded, ONNX Runtime starts its thread pools with the session
+    // and they would inherit the real-time schedule and CPUs of the caller
+    ThreadScheduleReset unscheduled;
+
+    auto policy = std::make_shared<PolicyBundle>();
+    policy->robot_path = robot_path;
+    // base.yaml values are kept, config.yaml overrides the rest
+    policy->params = this->base_params;
+    policy->onnx_engine = std::make_shared<ONNXInferenceEngine>();
+    ModelParams &params = policy->params;
+    ONNXInferenceEngine &onnx_engine = *policy->onnx_engine;
+
     try {
-        this->ReadYamlRL(robot_path);
-        for (std::string &observation : this->params.observations)
+        this->ReadYamlRL(robot_path, params);
+        for (std::string &observation : params.observations)
         {
             if (observation == "ang_vel")
             {
@@ -236,22 +432,21 @@ void RL::InitRL(std::string robot_path)
             }
         }
 
-        // init rl
-        this->InitObservations();
-        this->InitOutputs();
-        this->InitControl();
-
-        // init obs history
-        if (!this->params.observations_history.empty())
+        // validate the observation terms and build the obs history
+        int num_obs = BuildObservationPlan(params, policy->obs_plan);
+        for (const ObservationPlanEntry &entry : policy->obs_plan)
+        {
+            policy->obs_dims.push_back(entry.dims);
+        }
+        if (!params.observations_history.empty())
         {
-            int history_length = *std::max_element(this->params.observations_history.begin(), this->params.observations_history.end()) + 1;
-            this->history_obs_buf = ObservationBuffer(1, this->obs_dims, history_length, this->params.observations_history_priority);
-            // this->history_obs_buf = ObservationBuffer(1, this->params.num_observations, history_length);
+            // fails here rather than on activation if the history settings are invalid
+            MakeHistoryBuffer(params, policy->obs_dims);
         }
 
         // init model
-        std::string model_path = std::string(CMAKE_CURRENT_SOURCE_DIR) + "/policy/" + robot_path + "/" + this->params.model_name;
-        std::cout << "[RL_SDK] Model specified in config: " << this->params.model_name << std::endl;
+        std::string model_path = std::string(CMAKE_CURRENT_SOURCE_DIR) + "/policy/" + robot_path + "/" + params.model_name;
+        std::cout << "[RL_SDK] Model specified in config: " << params.model_name << std::endl;
         
         // Check if model file exists
         std::ifstream model_file(model_path);
@@ -261,29 +456,30 @@ void RL::InitRL(std::string robot_path)
         model_file.close();
         
         // Determine model type and load accordingly
-        if (this->params.model_name.find(".onnx") != std::string::npos) {
+        if (params.model_name.find(".onnx") != std::string::npos) {
             // Config specifies ONNX model - load only ONNX
             std::cout << "[RL_SDK] Loading ONNX model: " << model_path << std::endl;
             try {
-                this->onnx_engine.LoadModel(model_path);
+                onnx_engine.LoadModel(model_path);
                 std::cout << "[RL_SDK] ONNX model loaded successfully" << std::endl;
             } catch (const std::exception& e) {
                 throw std::runtime_error("Failed to load ONNX model: " + std::string(e.what()));
             }
 
-            // Get all output tensors for ref motion data
-            auto outputs = this->onnx_engine.FirstOutput();
-
-            auto body_quat_w = this->onnx_engine.ExtractTensorData(outputs[4]);
-
-            std::vector<float> motion_anchor_quat_w = {body_quat_w[28], 
-                                                        body_quat_w[29],
-                                                        body_quat_w[30],
-                                                        body_quat_w[31]};
+            // The policy input is the current observation, or the stacked history of it
+            const std::vector<std::vector<int64_t>> &input_shapes = onnx_engine.GetInputShapes();
+            int64_t expected_input = static_cast<int64_t>(num_obs) * std::max<size_t>(1, params.observations_history.size());
+            if (!input_shapes.empty() && !input_shapes[0].empty() && input_shapes[0].back() > 0 && input_shapes[0].back() != expected_input)
+            {
+                std::cout << LOGGER::WARNING << "Model " << params.model_name << " expects " << input_shapes[0].back()
+                          << " inputs but the observation layout provides " << expected_input << std::endl;
+            }
 
-            this->ref_joint_pos = this->VectorToTensor(this->onnx_engine.ExtractTensorData(outputs[1]), {1, 29});
-            this->ref_joint_vel = this->VectorToTensor(this->onnx_engine.ExtractTensorData(outputs[2]), {1, 29});
-            this->ref_body_quat_w = this->VectorToTensor(motion_anchor_quat_w, {1, 4});
+            policy->onnx_motion_outputs = InitOnnxOutputs(onnx_engine);
+            if (policy->onnx_motion_outputs)
+            {
+                InitMotionReference(onnx_engine, *policy);
+            }
 
             // Try to find corresponding PyTorch model for fallback
             std::string pt_model_path = model_path;
@@ -294,30 +490,29 @@ void RL::InitRL(std::string robot_path)
                 if (pt_file.good()) {
                     pt_file.close();
                     try {
-                        this->model = torch::jit::load(pt_model_path);
-                        this->pytorch_model_loaded = true;
+                        policy->model = torch::jit::load(pt_model_path);
+                        policy->pytorch_model_loaded = true;
                         std::cout << "[RL_SDK] PyTorch fallback model loaded: " << pt_model_path << std::endl;
                     } catch (const std::exception& e) {
                         std::cout << "[RL_SDK] Warning: Failed to load PyTorch fallback model: " << e.what() << std::endl;
-                        this->pytorch_model_loaded = false;
+                        policy->pytorch_model_loaded = false;
                     }
                 } else {
                     std::cout << "[RL_SDK] Warning: No PyTorch fallback model found at: " << pt_model_path << std::endl;
-                    this->pytorch_model_loaded = false;
+                    policy->pytorch_model_loaded = false;
                 }
             }
-        } else if (this->params.model_name.find(".pt") != std::string::npos) {
+        } else if (params.model_name.find(".pt") != std::string::npos) {
             // Config specifies PyTorch model - load PyTorch first, then try ONNX
             std::cout << "[RL_SDK] Loading PyTorch model: " << model_path << std::endl;
             try {
-                this->model = torch::jit::load(model_path);
-                this->pytorch_model_loaded = true;
+                policy->model = torch::jit::load(model_path);
+                policy->pytorch_model_loaded = true;
                 std::cout << "[RL_SDK] PyTorch model loaded successfully" << std::endl;
             } catch (const std::exception& e) {
                 throw std::runtime_error("Failed to load PyTorch model: " + std::string(e.what()));
             }
             
-            this->onnx_engine.model_loaded_ = false;  // Reset ONNX model loaded flag
             // Try to load corresponding ONNX model
             std::string onnx_model_path = model_path;
             size_t pt_pos = onnx_model_path.find(".pt");
@@ -327,9 +522,15 @@ void RL::InitRL(std::string robot_path)
                 if (onnx_file.good()) {
                     onnx_file.close();
                     try {
-                        this->onnx_engine.LoadModel(onnx_model_path);
+                        onnx_engine.LoadModel(onnx_model_path);
+                        policy->onnx_motion_outputs = InitOnnxOutputs(onnx_engine);
+                        if (policy->onnx_motion_outputs)
+                        {
+                            InitMotionReference(onnx_engine, *policy);
+                        }
                         std::cout << "[RL_SDK] ONNX model loaded successfully: " << onnx_model_path << std::endl;
                     } catch (const std::exception& e) {
+                        onnx_engine.model_loaded_ = false;
                         std::cout << "[RL_SDK] Failed to load ONNX model: " << e.what() << std::endl;
                         std::cout << "[RL_SDK] Will use PyTorch model only" << std::endl;
                     }
@@ -342,56 +543,235 @@ void RL::InitRL(std::string robot_path)
             // Unknown model format - assume PyTorch for backward compatibility
             std::cout << "[RL_SDK] Unknown model format, assuming PyTorch: " << model_path << std::endl;
             try {
-                this->model = torch::jit::load(model_path);
-                this->pytorch_model_loaded = true;
+                policy->model = torch::jit::load(model_path);
+                policy->pytorch_model_loaded = true;
                 std::cout << "[RL_SDK] PyTorch model loaded successfully" << std::endl;
             } catch (const std::exception& e) {
                 throw std::runtime_error("Failed to load model as PyTorch: " + std::string(e.what()));
             }
         }
         
-        std::cout << "[RL_SDK] Model initialization completed successfully" << std::endl;
+        std::cout << "[RL_SDK] Model initialization completed successfully: " << robot_path << std::endl;
         
     } catch (const std::exception& e) {
-        std::cerr << "[ERROR] InitRL() failed: " << e.what() << std::endl;
+        std::cerr << "[ERROR] LoadPolicy() failed: " << e.what() << std::endl;
         std::cerr << "[ERROR] Robot path: " << robot_path << std::endl;
-        std::cerr << "[ERROR] Model name: " << this->params.model_name << std::endl;
+        std::cerr << "[ERROR] Model name: " << params.model_name << std::endl;
         throw;
     }
+    return policy;
 }
 
-void RL::ComputeOutput(const torch::Tensor &actions, torch::Tensor &output_dof_pos, torch::Tensor &output_dof_vel, torch::Tensor &output_dof_tau)
+void RL::ActivatePolicy(const std::shared_ptr<PolicyBundle> &policy)
+{
+    std::shared_ptr<PolicyState> state = BuildPolicyState(policy);
+    std::swap(this->params, state->params);
+    this->InitControl();
+    this->output_mailbox.Update();
+    this->ApplyPolicyState(*state);
+}
+
+void RL::SwitchPolicy(const std::shared_ptr<PolicyState> &state)
 {
-    torch::Tensor actions_scaled = actions * this->params.action_scale;
-    torch::Tensor pos_actions_scaled = actions_scaled.clone();
-    torch::Tensor vel_actions_scaled = torch::zeros_like(actions);
-    for (int i : this->params.wheel_indices)
+    // The control loop runs with the new params from here on, the model loop from its next tick. An output of the
+    // previous policy that was not consumed yet is dropped, one still in flight carries its own gains.
+    std::swap(this->params, state->params);
+    this->InitControl();
+    this->output_mailbox.Update();
+    std::atomic_store(&this->pending_policy_state, state);
+}
+
+void RL::ApplyPendingPolicyState()
+{
+    std::shared_ptr<PolicyState> state = std::atomic_exchange(&this->pending_policy_state, std::shared_ptr<PolicyState>());
+    if (!state)
     {
-        pos_actions_scaled[0][i] = 0.0;
-        vel_actions_scaled[0][i] = actions_scaled[0][i];
+        return;
     }
-    torch::Tensor all_actions_scaled = pos_actions_scaled + vel_actions_scaled;
-    output_dof_pos = pos_actions_scaled + this->params.default_dof_pos;
-    output_dof_vel = vel_actions_scaled;
-    output_dof_tau = this->params.rl_kp * (all_actions_scaled + this->params.default_dof_pos - this->obs.dof_pos) - this->params.rl_kd * this->obs.dof_vel;
-    output_dof_tau = torch::clamp(output_dof_tau, -(this->params.torque_limits), this->params.torque_limits);
+    this->ApplyPolicyState(*state);
+    // Holds the previous policy state now, freed by the next PreparePolicy
+    std::atomic_store(&this->retired_policy_state, state);
 }
 
-torch::Tensor RL::QuatRotateInverse(torch::Tensor q, torch::Tensor v)
+void RL::ApplyPolicyState(PolicyState &state)
+{
+    // Swaps only, nothing is allocated or freed here
+    std::swap(this->policy_params, state.policy_params);
+    std::swap(this->model, state.model);
+    std::swap(this->pytorch_model_loaded, state.pytorch_model_loaded);
+    std::swap(this->onnx_engine, state.onnx_engine);
+    std::swap(this->onnx_motion_outputs, state.onnx_motion_outputs);
+    std::swap(this->obs, state.obs);
+    std::swap(this->obs_dims, state.obs_dims);
+    std::swap(this->obs_plan, state.obs_plan);
+    std::swap(this->obs_data, state.obs_data);
+    std::swap(this->obs_tensor, state.obs_tensor);
+    std::swap(this->history_obs_buf, state.history_obs_buf);
+    std::swap(this->history_obs, state.history_obs);
+    std::swap(this->output_dof_tau, state.output_dof_tau);
+    std::swap(this->output_dof_pos, state.output_dof_pos);
+    std::swap(this->output_dof_vel, state.output_dof_vel);
+    std::swap(this->ref_joint_pos, state.ref_joint_pos);
+    std::swap(this->ref_joint_vel, state.ref_joint_vel);
+    std::swap(this->ref_anchor_quat, state.ref_anchor_quat);
+    std::swap(this->active_policy, state.policy);
+    this->init_to_world = Eigen::Matrix3d::Identity();
+    this->calc_anchor_called = 0;
+}
+
+bool RL::InitOnnxOutputs(ONNXInferenceEngine &engine)
 {
-    torch::Tensor q_w;
-    torch::Tensor q_vec;
+    // BeyondMimic policies export the reference motion next to the actions, anything else is not fetched
+    bool motion_outputs = engine.FindOutput("body_quat_w") >= 0;
+    if (motion_outputs)
+    {
+        engine.SelectOutputs({"actions", "joint_pos", "joint_vel", "body_quat_w"});
+    }
+    else
+    {
+        engine.SelectOutputs({engine.GetOutputNames()[0]});
+    }
+    return motion_outputs;
+}
 
-    // wxyz
-    q_w = q.index({torch::indexing::Slice(), 0});
-    q_vec = q.index({torch::indexing::Slice(), torch::indexing::Slice(1, 4)});
+void RL::UpdateMotionReference()
+{
+    // Slots follow the selection made in InitOnnxOutputs, the views point into the engine output buffers
+    TensorView<float> joint_pos = this->onnx_engine->GetOutputView<float>(1);
+    TensorView<float> joint_vel = this->onnx_engine->GetOutputView<float>(2);
+    TensorView<float> anchor_quat_w = this->onnx_engine->GetOutputView<float>(3).Subview(28, 4);
+
+    std::memcpy(this->ref_joint_pos.data_ptr<float>(), joint_pos.data, joint_pos.size * sizeof(float));
+    std::memcpy(this->ref_joint_vel.data_ptr<float>(), joint_vel.data, joint_vel.size * sizeof(float));
+    std::copy(anchor_quat_w.data, anchor_quat_w.data + 4, this->ref_anchor_quat.begin());
+}
 
-    c10::IntArrayRef shape = q.sizes();
+static void CopyTensorToArray(const torch::Tensor &src, double *dst, int size)
+{
+    if (src.scalar_type() == torch::kFloat64 && src.is_contiguous())
+    {
+        const double *data = src.data_ptr<double>();
+        std::copy(data, data + std::min<int>(size, src.numel()), dst);
+        return;
+    }
+    torch::Tensor values = src;
+    if (values.scalar_type() != torch::kFloat32 || !values.is_contiguous())
+    {
+        values = values.to(torch::kFloat32).contiguous();
+    }
+    const float *data = values.data_ptr<float>();
+    size = std::min<int>(size, values.numel());
+    for (int i = 0; i < size; ++i)
+    {
+        dst[i] = data[i];
+    }
+}
 
-    torch::Tensor a = v * (2.0 * torch::pow(q_w, 2) - 1.0).unsqueeze(-1);
-    torch::Tensor b = torch::cross(q_vec, v, -1) * q_w.unsqueeze(-1) * 2.0;
-    torch::Tensor c = q_vec * torch::bmm(q_vec.view({shape[0], 1, 3}), v.view({shape[0], 3, 1})).squeeze(-1) * 2.0;
-    return a - b + c;
+void RL::PublishOutput()
+{
+    PolicyOutput &output = this->output_mailbox.WriteBuffer();
+    output.num_of_dofs = this->policy_params.num_of_dofs;
+    output.tick = this->episode_length_buf;
+    CopyTensorToArray(this->output_dof_pos, output.dof_pos.data(), output.num_of_dofs);
+    CopyTensorToArray(this->output_dof_vel, output.dof_vel.data(), output.num_of_dofs);
+    CopyTensorToArray(this->output_dof_tau, output.dof_tau.data(), output.num_of_dofs);
+    std::copy_n(this->policy_params.joint.rl_kp.begin(), output.num_of_dofs, output.kp.begin());
+    std::copy_n(this->policy_params.joint.rl_kd.begin(), output.num_of_dofs, output.kd.begin());
+    this->output_mailbox.Publish();
+}
+
+torch::Tensor RL::Forward()
+{
+    torch::autograd::GradMode::set_enabled(false);
+
+    // Both backends take the stacked history when the config has one, the exports are traced on the same input
+    torch::Tensor input = this->ComputeObservation();
+    if (!this->policy_params.observations_history.empty())
+    {
+        this->history_obs_buf.insert(input);
+        // history_obs is sized in BuildPolicyState, the buffer follows the plan built for observations_history
+        this->history_obs_buf.gather_obs_vec(this->history_obs.data_ptr<float>());
+        input = this->history_obs;
+    }
+
+    // The policy output is copied into obs.actions, sized in InitObservations, and clipped there in place. It is
+    // owned by RL, so the ONNX output buffer can be overwritten by the next Run.
+    float *actions = this->obs.actions.data_ptr<float>();
+    const int num_actions = static_cast<int>(this->obs.actions.numel());
+    if (this->onnx_engine->IsModelLoaded())
+    {
+        this->onnx_engine->Run(input.data_ptr<float>(), input.numel(), static_cast<float>(this->episode_length_buf));
+        TensorView<float> view = this->onnx_engine->GetOutputView<float>(0);
+        if (static_cast<int>(view.size) != num_actions)
+        {
+            throw std::runtime_error("Policy output has " + std::to_string(view.size) + " values, expected " + std::to_string(num_actions));
+        }
+        std::memcpy(actions, view.data, num_actions * sizeof(float));
+        if (this->onnx_motion_outputs)
+        {
+            this->UpdateMotionReference();
+        }
+    }
+    else if (this->pytorch_model_loaded)
+    {
+        torch::Tensor output = this->model.forward({input}).toTensor();
+        if (output.numel() != num_actions)
+        {
+            throw std::runtime_error("Policy output has " + std::to_string(output.numel()) + " values, expected " + std::to_string(num_actions));
+        }
+        CopyTensorData(actions, output, num_actions);
+    }
+    else
+    {
+        throw std::runtime_error("No valid inference model available (neither ONNX nor PyTorch model loaded)");
+    }
+
+    if (this->policy_params.clip_actions_upper.numel() != 0 && this->policy_params.clip_actions_lower.numel() != 0)
+    {
+        const ModelParams::JointArrays &joint = this->policy_params.joint;
+        for (int i = 0; i < num_actions; ++i)
+        {
+            actions[i] = static_cast<float>(std::min(std::max(static_cast<double>(actions[i]), joint.clip_actions_lower[i]), joint.clip_actions_upper[i]));
+        }
+    }
+    return this->obs.actions;
+}
+
+void RL::ComputeOutput(const torch::Tensor &actions, torch::Tensor &output_dof_pos, torch::Tensor &output_dof_vel, torch::Tensor &output_dof_tau)
+{
+    // Written in place into the preallocated [1, num_of_dofs] float outputs from the raw dof state of this tick
+    const ModelParams::JointArrays &joint = this->policy_params.joint;
+    const int num_of_dofs = this->policy_params.num_of_dofs;
+    float action[ModelParams::kMaxDofs];
+    CopyTensorData(action, actions, num_of_dofs);
+    float *dof_pos = output_dof_pos.data_ptr<float>();
+    float *dof_vel = output_dof_vel.data_ptr<float>();
+    float *dof_tau = output_dof_tau.data_ptr<float>();
+
+    for (int i = 0; i < num_of_dofs; ++i)
+    {
+        const double action_scaled = action[i] * joint.action_scale[i];
+        dof_pos[i] = static_cast<float>(action_scaled + joint.default_dof_pos[i]);
+        dof_vel[i] = 0.0f;
+        const double tau = joint.rl_kp[i] * (action_scaled + joint.default_dof_pos[i] - this->obs.dof_pos[i]) - joint.rl_kd[i] * this->obs.dof_vel[i];
+        dof_tau[i] = static_cast<float>(std::min(std::max(tau, -joint.torque_limits[i]), joint.torque_limits[i]));
+    }
+    // Wheels are velocity controlled, the scaled action is their target velocity
+    for (int i : this->policy_params.wheel_indices)
+    {
+        dof_vel[i] = static_cast<float>(action[i] * joint.action_scale[i]);
+        dof_pos[i] = static_cast<float>(joint.default_dof_pos[i]);
+    }
+}
+
+torch::Tensor RL::QuatRotateInverse(torch::Tensor q, torch::Tensor v)
+{
+    // q [n, 4] wxyz, v [n, 3]
+    torch::Tensor q_f = q.to(torch::kFloat32).contiguous();
+    torch::Tensor v_f = v.to(torch::kFloat32).contiguous();
+    torch::Tensor out = torch::empty_like(v_f);
+    quaternion::RotateInverseBatch(q_f.data_ptr<float>(), v_f.data_ptr<float>(), out.data_ptr<float>(), static_cast<size_t>(q_f.size(0)));
+    return out;
 }
 
 void RL::TorqueProtect(torch::Tensor origin_output_dof_tau)
@@ -401,8 +781,8 @@ void RL::TorqueProtect(torch::Tensor origin_output_dof_tau)
     for (int i = 0; i < origin_output_dof_tau.size(1); ++i)
     {
         double torque_value = origin_output_dof_tau[0][i].item<double>();
-        double limit_lower = -this->params.torque_limits[0][i].item<double>();
-        double limit_upper = this->params.torque_limits[0][i].item<double>();
+        double limit_lower = -this->policy_params.joint.torque_limits[i];
+        double limit_upper = this->policy_params.joint.torque_limits[i];
 
         if (torque_value < limit_lower || torque_value > limit_upper)
         {
@@ -416,8 +796,8 @@ void RL::TorqueProtect(torch::Tensor origin_output_dof_tau)
         {
             int index = out_of_range_indices[i];
             double value = out_of_range_values[i];
-            double limit_lower = -this->params.torque_limits[0][index].item<double>();
-            double limit_upper = this->params.torque_limits[0][index].item<double>();
+            double limit_lower = -this->policy_params.joint.torque_limits[index];
+            double limit_upper = this->policy_params.joint.torque_limits[index];
 
             std::cout << LOGGER::WARNING << "Torque(" << index + 1 << ")=" << value << " out of range(" << limit_lower << ", " << limit_upper << ")" << std::endl;
         }
@@ -427,32 +807,13 @@ void RL::TorqueProtect(torch::Tensor origin_output_dof_tau)
     }
 }
 
-void RL::AttitudeProtect(const std::vector<double> &quaternion, float pitch_threshold, float roll_threshold)
+void RL::AttitudeProtect(const std::array<double, 4> &quat, float pitch_threshold, float roll_threshold)
 {
-    float rad2deg = 57.2958;
-    float w, x, y, z;
-
-    w = quaternion[0];
-    x = quaternion[1];
-    y = quaternion[2];
-    z = quaternion[3];
-
-    // Calculate roll (rotation around the X-axis)
-    float sinr_cosp = 2 * (w * x + y * z);
-    float cosr_cosp = 1 - 2 * (x * x + y * y);
-    float roll = std::atan2(sinr_cosp, cosr_cosp) * rad2deg;
-
-    // Calculate pitch (rotation around the Y-axis)
-    float sinp = 2 * (w * y - z * x);
-    float pitch;
-    if (std::fabs(sinp) >= 1)
-    {
-        pitch = std::copysign(90.0, sinp); // Clamp to avoid out-of-range values
-    }
-    else
-    {
-        pitch = std::asin(sinp) * rad2deg;
-    }
+    const double rad2deg = 180.0 / M_PI;
+    double roll, pitch;
+    quaternion::RollPitch(quat.data(), &roll, &pitch);
+    roll *= rad2deg;
+    pitch *= rad2deg;
 
     if (std::fabs(roll) > roll_threshold)
     {
@@ -559,6 +920,18 @@ std::vector<T> ReadVectorFromYaml(const YAML::Node &node)
     return values;
 }
 
+static void CheckDofCapacity(int num_of_dofs)
+{
+    // every per-joint buffer is sized by ROBOT_MAX_DOFS, so one check covers them all
+    static_assert(RobotState<double>::kDofs == ROBOT_MAX_DOFS && ModelParams::kMaxDofs == ROBOT_MAX_DOFS &&
+                  PolicyOutput::kMaxDofs == ROBOT_MAX_DOFS, "per-joint buffers must share ROBOT_MAX_DOFS");
+    if (num_of_dofs > ROBOT_MAX_DOFS)
+    {
+        throw std::runtime_error("num_of_dofs " + std::to_string(num_of_dofs) + " exceeds ROBOT_MAX_DOFS " +
+                                 std::to_string(ROBOT_MAX_DOFS) + ", reconfigure with -DROBOT_MAX_DOFS=" + std::to_string(num_of_dofs));
+    }
+}
+
 void RL::ReadYamlBase(std::string robot_path)
 {
     // The config file is located at "rl_sar/src/rl_sar/policy/<robot_path>/base.yaml"
@@ -578,6 +951,7 @@ void RL::ReadYamlBase(std::string robot_path)
     this->params.decimation = config["decimation"].as<int>();
     this->params.wheel_indices = ReadVectorFromYaml<int>(config["wheel_indices"]);
     this->params.num_of_dofs = config["num_of_dofs"].as<int>();
+    CheckDofCapacity(this->params.num_of_dofs);
     this->params.fixed_kp = torch::tensor(ReadVectorFromYaml<double>(config["fixed_kp"])).view({1, -1});
     this->params.fixed_kd = torch::tensor(ReadVectorFromYaml<double>(config["fixed_kd"])).view({1, -1});
     this->params.torque_limits = torch::tensor(ReadVectorFromYaml<double>(config["torque_limits"])).view({1, -1});
@@ -585,9 +959,32 @@ void RL::ReadYamlBase(std::string robot_path)
     this->params.joint_names = ReadVectorFromYaml<std::string>(config["joint_names"]);
     this->params.joint_controller_names = ReadVectorFromYaml<std::string>(config["joint_controller_names"]);
     this->params.joint_mapping = ReadVectorFromYaml<int>(config["joint_mapping"]);
+    this->params.UpdateJointArrays();
+    this->base_params = this->params;
+    this->policy_params = this->params;
+
+    this->loop_schedules.clear();
+    if (config["loops"])
+    {
+        for (const auto &loop : config["loops"])
+        {
+            LoopSchedule schedule;
+            const YAML::Node &node = loop.second;
+            if (node["policy"]) schedule.policy = node["policy"].as<std::string>();
+            if (node["priority"]) schedule.priority = node["priority"].as<int>();
+            if (node["cpus"]) schedule.cpus = ReadVectorFromYaml<int>(node["cpus"]);
+            this->loop_schedules[loop.first.as<std::string>()] = schedule;
+        }
+    }
 }
 
-void RL::ReadYamlRL(std::string robot_path)
+LoopSchedule RL::GetLoopSchedule(const std::string &loop_name) const
+{
+    auto it = this->loop_schedules.find(loop_name);
+    return it != this->loop_schedules.end() ? it->second : LoopSchedule();
+}
+
+void RL::ReadYamlRL(std::string robot_path, ModelParams &params)
 {
     // The config file is located at "rl_sar/src/rl_sar/policy/<robot_path>/config.yaml"
     std::string config_path = std::string(CMAKE_CURRENT_SOURCE_DIR) + "/policy/" + robot_path + "/config.yaml";
@@ -602,50 +999,77 @@ void RL::ReadYamlRL(std::string robot_path)
         return;
     }
 
-    this->params.model_name = config["model_name"].as<std::string>();
-    this->params.num_observations = config["num_observations"].as<int>();
-    this->params.observations = ReadVectorFromYaml<std::string>(config["observations"]);
+    params.model_name = config["model_name"].as<std::string>();
+    params.num_observations = config["num_observations"].as<int>();
+    params.observations = ReadVectorFromYaml<std::string>(config["observations"]);
     if (config["observations_history"].IsNull())
     {
-        this->params.observations_history = {};
+        params.observations_history = {};
     }
     else
     {
-        this->params.observations_history = ReadVectorFromYaml<int>(config["observations_history"]);
+        params.observations_history = ReadVectorFromYaml<int>(config["observations_history"]);
     }
-    this->params.observations_history_priority = config["observations_history_priority"].as<std::string>();
-    this->params.clip_obs = config["clip_obs"].as<double>();
+    params.observations_history_priority = config["observations_history_priority"].as<std::string>();
+    params.clip_obs = config["clip_obs"].as<double>();
     if (config["clip_actions_lower"].IsNull() && config["clip_actions_upper"].IsNull())
     {
-        this->params.clip_actions_upper = torch::tensor({}).view({1, -1});
-        this->params.clip_actions_lower = torch::tensor({}).view({1, -1});
+        params.clip_actions_upper = torch::tensor({}).view({1, -1});
+        params.clip_actions_lower = torch::tensor({}).view({1, -1});
     }
     else
     {
-        this->params.clip_actions_upper = torch::tensor(ReadVectorFromYaml<double>(config["clip_actions_upper"])).view({1, -1});
-        this->params.clip_actions_lower = torch::tensor(ReadVectorFromYaml<double>(config["clip_actions_lower"])).view({1, -1});
+        params.clip_actions_upper = torch::tensor(ReadVectorFromYaml<double>(config["clip_actions_upper"])).view({1, -1});
+        params.clip_actions_lower = torch::tensor(ReadVectorFromYaml<double>(config["clip_actions_lower"])).view({1, -1});
     }
-    this->params.action_scale = torch::tensor(ReadVectorFromYaml<double>(config["action_scale"])).view({1, -1});
-    this->params.wheel_indices = ReadVectorFromYaml<int>(config["wheel_indices"]);
-    this->params.num_of_dofs = config["num_of_dofs"].as<int>();
-    this->params.lin_vel_scale = config["lin_vel_scale"].as<double>();
-    this->params.ang_vel_scale = config["ang_vel_scale"].as<double>();
-    this->params.dof_pos_scale = config["dof_pos_scale"].as<double>();
-    this->params.dof_vel_scale = config["dof_vel_scale"].as<double>();
-    this->params.commands_scale = torch::tensor(ReadVectorFromYaml<double>(config["commands_scale"])).view({1, -1});
-    // this->params.commands_scale = torch::tensor({this->params.lin_vel_scale, this->params.lin_vel_scale, this->params.ang_vel_scale});
-    this->params.rl_kp = torch::tensor(ReadVectorFromYaml<double>(config["rl_kp"])).view({1, -1});
-    this->params.rl_kd = torch::tensor(ReadVectorFromYaml<double>(config["rl_kd"])).view({1, -1});
-    this->params.fixed_kp = torch::tensor(ReadVectorFromYaml<double>(config["fixed_kp"])).view({1, -1});
-    this->params.fixed_kd = torch::tensor(ReadVectorFromYaml<double>(config["fixed_kd"])).view({1, -1});
-    this->params.torque_limits = torch::tensor(ReadVectorFromYaml<double>(config["torque_limits"])).view({1, -1});
-    this->params.default_dof_pos = torch::tensor(ReadVectorFromYaml<double>(config["default_dof_pos"])).view({1, -1});
-    this->params.joint_mapping = ReadVectorFromYaml<int>(config["joint_mapping"]);
+    params.action_scale = torch::tensor(ReadVectorFromYaml<double>(config["action_scale"])).view({1, -1});
+    params.wheel_indices = ReadVectorFromYaml<int>(config["wheel_indices"]);
+    params.num_of_dofs = config["num_of_dofs"].as<int>();
+    CheckDofCapacity(params.num_of_dofs);
+    params.lin_vel_scale = config["lin_vel_scale"].as<double>();
+    params.ang_vel_scale = config["ang_vel_scale"].as<double>();
+    params.dof_pos_scale = config["dof_pos_scale"].as<double>();
+    params.dof_vel_scale = config["dof_vel_scale"].as<double>();
+    params.commands_scale = torch::tensor(ReadVectorFromYaml<double>(config["commands_scale"])).view({1, -1});
+    // params.commands_scale = torch::tensor({params.lin_vel_scale, params.lin_vel_scale, params.ang_vel_scale});
+    params.rl_kp = torch::tensor(ReadVectorFromYaml<double>(config["rl_kp"])).view({1, -1});
+    params.rl_kd = torch::tensor(ReadVectorFromYaml<double>(config["rl_kd"])).view({1, -1});
+    params.fixed_kp = torch::tensor(ReadVectorFromYaml<double>(config["fixed_kp"])).view({1, -1});
+    params.fixed_kd = torch::tensor(ReadVectorFromYaml<double>(config["fixed_kd"])).view({1, -1});
+    params.torque_limits = torch::tensor(ReadVectorFromYaml<double>(config["torque_limits"])).view({1, -1});
+    params.default_dof_pos = torch::tensor(ReadVectorFromYaml<double>(config["default_dof_pos"])).view({1, -1});
+    params.joint_mapping = ReadVectorFromYaml<int>(config["joint_mapping"]);
+    params.UpdateJointArrays();
+}
+
+static void CopyJointTensor(const torch::Tensor &src, std::array<double, ModelParams::kMaxDofs> &dst)
+{
+    dst.fill(0.0);
+    if (!src.defined())
+    {
+        return;
+    }
+    torch::Tensor values = src.to(torch::kFloat64).contiguous().view(-1);
+    const int64_t size = std::min<int64_t>(values.numel(), dst.size());
+    std::copy(values.data_ptr<double>(), values.data_ptr<double>() + size, dst.begin());
+}
+
+void ModelParams::UpdateJointArrays()
+{
+    CopyJointTensor(this->rl_kp, this->joint.rl_kp);
+    CopyJointTensor(this->rl_kd, this->joint.rl_kd);
+    CopyJointTensor(this->fixed_kp, this->joint.fixed_kp);
+    CopyJointTensor(this->fixed_kd, this->joint.fixed_kd);
+    CopyJointTensor(this->torque_limits, this->joint.torque_limits);
+    CopyJointTensor(this->default_dof_pos, this->joint.default_dof_pos);
+    CopyJointTensor(this->action_scale, this->joint.action_scale);
+    CopyJointTensor(this->clip_actions_upper, this->joint.clip_actions_upper);
+    CopyJointTensor(this->clip_actions_lower, this->joint.clip_actions_lower);
 }
 
-void RL::CSVInit(std::string robot_path)
+void RL::TelemetryInit(std::string robot_path)
 {
-    csv_filename = std::string(CMAKE_CURRENT_SOURCE_DIR) + "/policy/" + robot_path + "/motor";
+    std::string filename = std::string(CMAKE_CURRENT_SOURCE_DIR) + "/policy/" + robot_path + "/motor";
 
     // Uncomment these lines if need timestamp for file name
     // auto now = std::chrono::system_clock::now();
@@ -653,35 +1077,37 @@ void RL::CSVInit(std::string robot_path)
     // std::stringstream ss;
     // ss << std::put_time(std::localtime(&now_c), "%Y%m%d%H%M%S");
     // std::string timestamp = ss.str();
-    // csv_filename += "_" + timestamp;
+    // filename += "_" + timestamp;
 
-    csv_filename += ".csv";
-    std::ofstream file(csv_filename.c_str());
+    filename += ".rltl";
 
-    for(int i = 0; i < this->params.num_of_dofs; ++i) { file << "tau_cal_" << i << ","; }
-    for(int i = 0; i < this->params.num_of_dofs; ++i) { file << "tau_est_" << i << ","; }
-    for(int i = 0; i < this->params.num_of_dofs; ++i) { file << "joint_pos_" << i << ","; }
-    for(int i = 0; i < this->params.num_of_dofs; ++i) { file << "joint_pos_target_" << i << ","; }
-    for(int i = 0; i < this->params.num_of_dofs; ++i) { file << "joint_vel_" << i << ","; }
-
-    file << std::endl;
+    std::vector<std::string> columns;
+    for (const char *prefix : {"tau_cal_", "tau_est_", "joint_pos_", "joint_pos_target_", "joint_vel_"})
+    {
+        for (int i = 0; i < this->params.num_of_dofs; ++i) { columns.push_back(prefix + std::to_string(i)); }
+    }
 
-    file.close();
+    this->telemetry.Open(filename, columns);
 }
 
-void RL::CSVLogger(torch::Tensor torque, torch::Tensor tau_est, torch::Tensor joint_pos, torch::Tensor joint_pos_target, torch::Tensor joint_vel)
+void RL::TelemetryRecord()
 {
-    std::ofstream file(csv_filename.c_str(), std::ios_base::app);
-
-    for(int i = 0; i < this->params.num_of_dofs; ++i) { file << torque[0][i].item<double>() << ","; }
-    for(int i = 0; i < this->params.num_of_dofs; ++i) { file << tau_est[0][i].item<double>() << ","; }
-    for(int i = 0; i < this->params.num_of_dofs; ++i) { file << joint_pos[0][i].item<double>() << ","; }
-    for(int i = 0; i < this->params.num_of_dofs; ++i) { file << joint_pos_target[0][i].item<double>() << ","; }
-    for(int i = 0; i < this->params.num_of_dofs; ++i) { file << joint_vel[0][i].item<double>() << ","; }
-
-    file << std::endl;
+    double *row = this->telemetry.Begin(this->episode_length_buf);
+    if (!row)
+    {
+        return;
+    }
 
-    file.close();
+    const int num_of_dofs = static_cast<int>(this->telemetry.Width() / 5);
+    const auto &tau_est = this->robot_state.motor_state.tau_est;
+    const auto &q = this->robot_state.motor_state.q;
+    const auto &dq = this->robot_state.motor_state.dq;
+    CopyTensorToArray(this->output_dof_tau, row, num_of_dofs);
+    std::copy(tau_est.begin(), tau_est.begin() + num_of_dofs, row + num_of_dofs);
+    std::copy(q.begin(), q.begin() + num_of_dofs, row + 2 * num_of_dofs);
+    CopyTensorToArray(this->output_dof_pos, row + 3 * num_of_dofs, num_of_dofs);
+    std::copy(dq.begin(), dq.begin() + num_of_dofs, row + 4 * num_of_dofs);
+    this->telemetry.Commit();
 }
 
 std::vector<float> RL::TensorToVector(const torch::Tensor& tensor)
@@ -708,8 +1134,41 @@ torch::Tensor RL::VectorToTensor(const std::vector<float>& vec, const std::vecto
     return tensor;
 }
 
-std::vector<float> RL::ComputeObservationFloat()
+const std::vector<float> &RL::ComputeObservationFloat()
+{
+    this->ComputeObservation();
+    return this->obs_data;
+}
+
+void PolicyRegistry::Preload(const std::vector<std::string> &robot_paths, const Loader &loader)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<int> loaded(0);
+    tbb::parallel_for(size_t(0), robot_paths.size(), [&](size_t i)
+    {
+        try
+        {
+            this->Add(loader(robot_paths[i]));
+            ++loaded;
+        }
+        catch (const std::exception &e)
+        {
+            std::cout << LOGGER::WARNING << "Policy '" << robot_paths[i] << "' failed to preload: " << e.what() << std::endl;
+        }
+    });
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << LOGGER::INFO << "Preloaded " << loaded << "/" << robot_paths.size() << " policies in " << elapsed.count() << " ms" << std::endl;
+}
+
+void PolicyRegistry::Add(const std::shared_ptr<PolicyBundle> &policy)
+{
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->policies_[policy->robot_path] = policy;
+}
+
+std::shared_ptr<PolicyBundle> PolicyRegistry::Get(const std::string &robot_path) const
 {
-    torch::Tensor obs_tensor = this->ComputeObservation();
-    return this->TensorToVector(obs_tensor);
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    auto it = this->policies_.find(robot_path);
+    return it != this->policies_.end() ? it->second : nullptr;
 }
@@ -12,11 +12,21 @@
 #include <exception>
 #include <unistd.h>
 #include <algorithm>
-#include <tbb/concurrent_queue.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <map>
+#include <array>
+#include <chrono>
 
 #include <yaml-cpp/yaml.h>
 #include "fsm_core.hpp"
+#include "loop.hpp"
+#include "triple_buffer.hpp"
+#include "telemetry_recorder.hpp"
 #include "observation_buffer.hpp"
+#include "quaternion.hpp"
 #include "onnx_engine.hpp"
 #include <Eigen/Dense>
 #include <Eigen/Core>
@@ -30,37 +40,57 @@ namespace LOGGER
     const char *const NOTE    = "\033[0;34m[NOTE]\033[0m ";
 }
 
-template <typename T>
+// Joint capacity of RobotState/RobotCommand, ModelParams::JointArrays and PolicyOutput, set by CMake to the largest
+// num_of_dofs of the robots built. ReadYamlBase/ReadYamlRL reject configs above it. There is no default, a translation
+// unit built without it would lay these types out differently from the rest of the program.
+#ifndef ROBOT_MAX_DOFS
+#error "ROBOT_MAX_DOFS is not defined, build with -DROBOT_MAX_DOFS=<joints> as CMakeLists.txt does"
+#endif
+
+// Cache-line alignment of the per-joint arrays, only requested where operator new honours it (C++17), RL
+// objects are heap allocated under ROS 2
+#if defined(__cpp_aligned_new)
+#define ROBOT_CACHELINE_ALIGN alignas(64)
+#else
+#define ROBOT_CACHELINE_ALIGN
+#endif
+
+// Fixed-capacity structure of arrays, trivially copyable so snapshots such as now_state = *fsm_state are a memcpy
+template <typename T, int DOFS = ROBOT_MAX_DOFS>
 struct RobotCommand
 {
+    static const int kDofs = DOFS;
+
     struct MotorCommand
     {
-        std::vector<int> mode = std::vector<int>(32, 0);
-        std::vector<T> q = std::vector<T>(32, 0.0);
-        std::vector<T> dq = std::vector<T>(32, 0.0);
-        std::vector<T> tau = std::vector<T>(32, 0.0);
-        std::vector<T> kp = std::vector<T>(32, 0.0);
-        std::vector<T> kd = std::vector<T>(32, 0.0);
+        ROBOT_CACHELINE_ALIGN std::array<int, DOFS> mode{};
+        ROBOT_CACHELINE_ALIGN std::array<T, DOFS> q{};
+        ROBOT_CACHELINE_ALIGN std::array<T, DOFS> dq{};
+        ROBOT_CACHELINE_ALIGN std::array<T, DOFS> tau{};
+        ROBOT_CACHELINE_ALIGN std::array<T, DOFS> kp{};
+        ROBOT_CACHELINE_ALIGN std::array<T, DOFS> kd{};
     } motor_command;
 };
 
-template <typename T>
+template <typename T, int DOFS = ROBOT_MAX_DOFS>
 struct RobotState
 {
+    static const int kDofs = DOFS;
+
     struct IMU
     {
-        std::vector<T> quaternion = {1.0, 0.0, 0.0, 0.0}; // w, x, y, z
-        std::vector<T> gyroscope = {0.0, 0.0, 0.0};
-        std::vector<T> accelerometer = {0.0, 0.0, 0.0};
+        std::array<T, 4> quaternion{{1.0, 0.0, 0.0, 0.0}}; // w, x, y, z
+        std::array<T, 3> gyroscope{};
+        std::array<T, 3> accelerometer{};
     } imu, torso_imu;
 
     struct MotorState
     {
-        std::vector<T> q = std::vector<T>(32, 0.0);
-        std::vector<T> dq = std::vector<T>(32, 0.0);
-        std::vector<T> ddq = std::vector<T>(32, 0.0);
-        std::vector<T> tau_est = std::vector<T>(32, 0.0);
-        std::vector<T> cur = std::vector<T>(32, 0.0);
+        ROBOT_CACHELINE_ALIGN std::array<T, DOFS> q{};
+        ROBOT_CACHELINE_ALIGN std::array<T, DOFS> dq{};
+        ROBOT_CACHELINE_ALIGN std::array<T, DOFS> ddq{};
+        ROBOT_CACHELINE_ALIGN std::array<T, DOFS> tau_est{};
+        ROBOT_CACHELINE_ALIGN std::array<T, DOFS> cur{};
     } motor_state;
 };
 
@@ -156,40 +186,176 @@ struct ModelParams
     std::vector<std::string> joint_controller_names;
     std::vector<std::string> joint_names;
     std::vector<int> joint_mapping;
+
+    // Plain copies of the per-joint tensors above for the control and model loops, which must not index tensors.
+    // Refreshed by UpdateJointArrays() whenever those tensors are assigned.
+    static const int kMaxDofs = ROBOT_MAX_DOFS;
+    struct JointArrays
+    {
+        std::array<double, kMaxDofs> rl_kp{};
+        std::array<double, kMaxDofs> rl_kd{};
+        std::array<double, kMaxDofs> fixed_kp{};
+        std::array<double, kMaxDofs> fixed_kd{};
+        std::array<double, kMaxDofs> torque_limits{};
+        std::array<double, kMaxDofs> default_dof_pos{};
+        std::array<double, kMaxDofs> action_scale{};
+        std::array<double, kMaxDofs> clip_actions_upper{};
+        std::array<double, kMaxDofs> clip_actions_lower{};
+    } joint;
+    void UpdateJointArrays();
 };
 
 struct Observations
 {
-    torch::Tensor lin_vel;
-    torch::Tensor ang_vel;
-    torch::Tensor gravity_vec;
-    torch::Tensor commands;
-    torch::Tensor base_quat;
-    torch::Tensor torso_quat;
-    torch::Tensor dof_pos;
-    torch::Tensor dof_vel;
+    // Per-tick state as the loops read it, ComputeObservation converts it straight into obs_data
+    std::array<double, 3> lin_vel{};
+    std::array<double, 3> ang_vel{};
+    std::array<double, 3> gravity_vec{{0.0, 0.0, -1.0}};
+    std::array<double, 3> commands{};
+    std::array<double, 4> base_quat{{1.0, 0.0, 0.0, 0.0}};
+    std::array<double, ROBOT_MAX_DOFS> dof_pos{};
+    std::array<double, ROBOT_MAX_DOFS> dof_vel{};
+    // [1, num_of_dofs], sized once per policy, Forward writes the clipped actions into it
     torch::Tensor actions;
     torch::Tensor motion_anchor_ori_b;
     torch::Tensor commands_motion;
 };
 
+enum class ObservationTerm
+{
+    LinVel,
+    AngVelBody,
+    AngVelWorld,
+    GravityVec,
+    Commands,
+    DofPos,
+    DofVel,
+    Actions,
+    Phase,
+    G1Phase,
+    G1MimicPhase,
+    CommandsMotionPos,
+    CommandsMotionVel,
+    MotionAnchorOriB
+};
+
+// One resolved observation term, written to obs_data[offset, offset + dims)
+struct ObservationPlanEntry
+{
+    ObservationTerm term;
+    const char *name;
+    int offset;
+    int dims;
+    float scale;
+    std::array<float, 3> commands_scale;  // from ModelParams::commands_scale for the commands term, converted once
+};
+
+// Policy targets handed from the model loop to the control loop. Fixed size, so publishing never allocates,
+// the mailbox slot adds the publish time and a sequence number.
+struct PolicyOutput
+{
+    static const int kMaxDofs = ROBOT_MAX_DOFS;
+    std::array<double, kMaxDofs> dof_pos{};
+    std::array<double, kMaxDofs> dof_vel{};
+    std::array<double, kMaxDofs> dof_tau{};
+    // gains of the policy that produced the targets, a switch can land between an inference and its publish
+    std::array<double, kMaxDofs> kp{};
+    std::array<double, kMaxDofs> kd{};
+    int num_of_dofs = 0;
+    unsigned long long tick = 0;  // episode_length_buf of the inference that produced it
+};
+
+// Everything InitRL builds for one config, loaded once and shared by every activation of that config
+struct PolicyBundle
+{
+    std::string robot_path;
+    ModelParams params;
+    std::vector<ObservationPlanEntry> obs_plan;
+    std::vector<int> obs_dims;
+    torch::jit::script::Module model;
+    bool pytorch_model_loaded = false;
+    std::shared_ptr<ONNXInferenceEngine> onnx_engine;
+    bool onnx_motion_outputs = false;
+    // reference motion at time step 0
+    torch::Tensor ref_joint_pos;
+    torch::Tensor ref_joint_vel;
+    std::array<double, 4> ref_anchor_quat{{1.0, 0.0, 0.0, 0.0}};
+};
+
+// Everything one activation of a bundle starts from, built by RL::BuildPolicyState off the control and model loops.
+// SwitchPolicy swaps params with the control loop's copy, the model loop swaps the rest in with
+// RL::ApplyPendingPolicyState, so the state the previous activation left behind is freed with this object.
+struct PolicyState
+{
+    std::shared_ptr<PolicyBundle> policy;
+    ModelParams params;         // for RL::params, the control loop
+    ModelParams policy_params;  // for RL::policy_params, the model loop
+    torch::jit::script::Module model;
+    bool pytorch_model_loaded = false;
+    std::shared_ptr<ONNXInferenceEngine> onnx_engine;
+    bool onnx_motion_outputs = false;
+    Observations obs;
+    std::vector<int> obs_dims;
+    std::vector<ObservationPlanEntry> obs_plan;
+    std::vector<float> obs_data;
+    torch::Tensor obs_tensor;
+    ObservationBuffer history_obs_buf;
+    torch::Tensor history_obs;
+    torch::Tensor output_dof_tau;
+    torch::Tensor output_dof_pos;
+    torch::Tensor output_dof_vel;
+    torch::Tensor ref_joint_pos;
+    torch::Tensor ref_joint_vel;
+    std::array<double, 4> ref_anchor_quat{{1.0, 0.0, 0.0, 0.0}};
+};
+
+class PolicyRegistry
+{
+public:
+    using Loader = std::function<std::shared_ptr<PolicyBundle>(const std::string &)>;
+
+    // Loads all paths in parallel. Failures are logged and left out, so the state entry loads them again
+    void Preload(const std::vector<std::string> &robot_paths, const Loader &loader);
+    void Add(const std::shared_ptr<PolicyBundle> &policy);
+    std::shared_ptr<PolicyBundle> Get(const std::string &robot_path) const;
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<PolicyBundle>> policies_;
+};
+
 class RL
 {
 public:
     RL() {};
-    ~RL() {};
+    // a prepare worker may still be loading into the registry and reading base_params
+    ~RL() { this->fsm.WaitPrepare(); };
 
+    // params of the active policy as seen by the control loop (FSM states, GetState, SetCommand), replaced by
+    // SwitchPolicy. The model loop reads policy_params, its own copy, replaced at the start of a model tick.
     ModelParams params;
+    ModelParams policy_params;
+    // params as read by ReadYamlBase, the starting point of every LoadPolicy. Written only at startup, unlike
+    // params, which SwitchPolicy replaces while prepare workers may be loading.
+    ModelParams base_params;
     Observations obs;
     std::vector<int> obs_dims;
+    std::vector<ObservationPlanEntry> obs_plan;
+    // contiguous observation storage sized in InitObservationPlan, obs_tensor is a view over obs_data
+    std::vector<float> obs_data;
+    torch::Tensor obs_tensor;
 
     RobotState<double> robot_state;
     RobotCommand<double> robot_command;
-    tbb::concurrent_queue<torch::Tensor> output_dof_pos_queue;
-    tbb::concurrent_queue<torch::Tensor> output_dof_vel_queue;
-    tbb::concurrent_queue<torch::Tensor> output_dof_tau_queue;
+    // latest policy output, written by the model loop and read by the FSM on the control loop, older values are dropped
+    TripleBuffer<PolicyOutput> output_mailbox;
+    void PublishOutput();
 
     FSM fsm;
+    // buffers the RLFSMStates point at, bound when the states are created and rebound only if the caller's buffers change
+    const RobotState<double> *fsm_bound_state = &robot_state;
+    RobotCommand<double> *fsm_bound_command = &robot_command;
+    void BindFSMBuffers(const RobotState<double> *state, RobotCommand<double> *command);
     RobotState<double> start_state;
     RobotState<double> now_state;
     float running_percent = 0.0f;
@@ -198,13 +364,43 @@ public:
     // Quaternion utils for efficient computation
 
     // init
-    void InitObservations();
+    static void InitObservations(PolicyState &state);
+    static void InitObservationPlan(PolicyState &state);
+    static void PrintObservationPlan(const std::vector<ObservationPlanEntry> &plan, size_t num_obs);
     void InitOutputs();
     void InitControl();
     void InitRL(std::string robot_path);
+    static int BuildObservationPlan(const ModelParams &params, std::vector<ObservationPlanEntry> &plan);
+
+    // policy registry, InitRL activates a preloaded bundle and only loads from disk on a miss
+    PolicyRegistry policy_registry;
+    std::shared_ptr<PolicyBundle> active_policy;
+    void PreloadPolicies(const std::vector<std::string> &config_names);
+    std::shared_ptr<PolicyBundle> LoadPolicy(const std::string &robot_path);
+    // Loads the bundle on a registry miss and builds the PolicyState InitRL activates next, off the control loop
+    void PreparePolicy(const std::string &robot_path);
+    bool IsPolicyPrepared(const std::string &robot_path) const;
+    std::shared_ptr<PolicyState> LoadPolicyState(const std::string &robot_path);
+    static std::shared_ptr<PolicyState> BuildPolicyState(const std::shared_ptr<PolicyBundle> &policy);
+    static ObservationBuffer MakeHistoryBuffer(const ModelParams &params, const std::vector<int> &obs_dims);
+    // Switches at once, for callers without a model loop (evaluation, benchmarks)
+    void ActivatePolicy(const std::shared_ptr<PolicyBundle> &policy);
+    // Control loop side of a switch: takes params and hands the rest to the model loop, never blocks or allocates
+    void SwitchPolicy(const std::shared_ptr<PolicyState> &state);
+    // Model loop side, called at the start of every model tick before anything reads the policy state
+    void ApplyPendingPolicyState();
+    void ApplyPolicyState(PolicyState &state);
+    // Shared between the loops only through std::atomic_load/store/exchange. prepared is written by the prepare
+    // worker and taken by InitRL, pending is published by SwitchPolicy and taken by the model loop, retired holds
+    // what the model loop swapped out until the next PreparePolicy frees it off the real-time loops.
+    std::shared_ptr<PolicyState> prepared_policy_state;
+    std::shared_ptr<PolicyState> pending_policy_state;
+    std::shared_ptr<PolicyState> retired_policy_state;
 
     // rl functions
-    virtual torch::Tensor Forward() = 0;
+    // ONNX first, TorchScript otherwise, fed the stacked history when the config has one. Returns obs.actions,
+    // which holds the clipped actions until the next call
+    torch::Tensor Forward();
     torch::Tensor ComputeObservation();
     virtual void GetState(RobotState<double> *state) = 0;
     virtual void SetCommand(const RobotCommand<double> *command) = 0;
@@ -214,12 +410,15 @@ public:
 
     // yaml params
     void ReadYamlBase(std::string robot_name);
-    void ReadYamlRL(std::string robot_name);
+    // per-loop thread scheduling from the "loops" section of base.yaml, keyed by loop name
+    std::map<std::string, LoopSchedule> loop_schedules;
+    LoopSchedule GetLoopSchedule(const std::string &loop_name) const;
+    void ReadYamlRL(std::string robot_name, ModelParams &params);
 
-    // csv logger
-    std::string csv_filename;
-    void CSVInit(std::string robot_name);
-    void CSVLogger(torch::Tensor torque, torch::Tensor tau_est, torch::Tensor joint_pos, torch::Tensor joint_pos_target, torch::Tensor joint_vel);
+    // telemetry, one binary row per RL tick, convert with scripts/telemetry_to_csv.py
+    TelemetryRecorder telemetry;
+    void TelemetryInit(std::string robot_name);
+    void TelemetryRecord();
 
     // control
     Control control;
@@ -238,17 +437,20 @@ public:
 
     // protect func
     void TorqueProtect(torch::Tensor origin_output_dof_tau);
-    void AttitudeProtect(const std::vector<double> &quaternion, float pitch_threshold, float roll_threshold);
+    void AttitudeProtect(const std::array<double, 4> &quat, float pitch_threshold, float roll_threshold);
 
     // conversion helpers for ONNX
     std::vector<float> TensorToVector(const torch::Tensor& tensor);
     torch::Tensor VectorToTensor(const std::vector<float>& vec, const std::vector<int64_t>& shape);
-    std::vector<float> ComputeObservationFloat();
+    const std::vector<float> &ComputeObservationFloat();
 
     // rl module
     torch::jit::script::Module model;
-    ONNXInferenceEngine onnx_engine;
+    std::shared_ptr<ONNXInferenceEngine> onnx_engine = std::make_shared<ONNXInferenceEngine>();
     bool pytorch_model_loaded = false;
+    bool onnx_motion_outputs = false;
+    static bool InitOnnxOutputs(ONNXInferenceEngine &engine);
+    void UpdateMotionReference();
     // output buffer
     torch::Tensor output_dof_tau;
     torch::Tensor output_dof_pos;
@@ -258,24 +460,67 @@ public:
     std::vector<std::string> motion_output_names;
     torch::Tensor ref_joint_pos;
     torch::Tensor ref_joint_vel;
-    torch::Tensor ref_body_quat_w;
+    std::array<double, 4> ref_anchor_quat{{1.0, 0.0, 0.0, 0.0}};   // w, x, y, z of the anchor body
     int calc_anchor_called;
-    Eigen::Quaterniond torso_quat;
-    Eigen::Quaterniond ref_motion_quat;
-    Eigen::Matrix3d YawQuaternion(const Eigen::Quaterniond& q);
     Eigen::Matrix3d init_to_world;
-    Eigen::Matrix3d motion_anchor_ori_b;
-    torch::Tensor motion_anchor_ori_b_mat;
+    // G1 waist joints the torso orientation is composed from
+    static const int kWaistYawIndex = 2;
+    static const int kWaistRollIndex = 5;
+    static const int kWaistPitchIndex = 8;
+    void ComputeMotionAnchorOriB(float *dst);
 };
 
 class RLFSMState : public FSMState
 {
 public:
-    RLFSMState(RL& rl, const std::string& name)
-        : FSMState(name), rl(rl), fsm_state(nullptr), fsm_command(nullptr) {}
+    RLFSMState(RL& rl, const std::string& name, const std::string& policy_config = "")
+        : FSMState(name), rl(rl), fsm_state(rl.fsm_bound_state), fsm_command(rl.fsm_bound_command), policy_config(policy_config) {}
     RL& rl;
     const RobotState<double>* fsm_state;
     RobotCommand<double>* fsm_command;
+    // config under policy/<robot_name>/ run by this state, empty for states without a policy
+    std::string policy_config;
+
+    // Policy states load from disk and build their PolicyState in Prepare, off the control thread, so Enter only
+    // hands it over
+    bool IsPrepared() const override
+    {
+        return policy_config.empty() || rl.IsPolicyPrepared(rl.robot_name + "/" + policy_config);
+    }
+    void Prepare() override
+    {
+        rl.PreparePolicy(rl.robot_name + "/" + policy_config);
+    }
+    void OnPrepareFailed(const std::string& reason) override
+    {
+        std::cout << LOGGER::ERROR << "Loading policy " << policy_config << " failed: " << reason << std::endl;
+        rl.control.current_keyboard = Input::Keyboard::Num0;
+    }
+
+    // Switch to target while the keyboard or gamepad input is active, None leaves that device unbound
+    struct KeyTransition
+    {
+        Input::Keyboard keyboard;
+        Input::Gamepad gamepad;
+        std::string target;
+    };
+
+    // Appends the table to the transitions, guard (if set) must also hold for any entry to fire
+    void AddTransitions(const std::vector<KeyTransition>& table, std::function<bool()> guard = nullptr)
+    {
+        const Control& control = rl.control;
+        for (const KeyTransition& entry : table)
+        {
+            const Input::Keyboard keyboard = entry.keyboard;
+            const Input::Gamepad gamepad = entry.gamepad;
+            AddTransition([&control, keyboard, gamepad, guard]()
+            {
+                return ((keyboard != Input::Keyboard::None && control.current_keyboard == keyboard) ||
+                        (gamepad != Input::Gamepad::None && control.current_gamepad == gamepad)) &&
+                       (!guard || guard());
+            }, entry.target);
+        }
+    }
 };
 
 template <typename T>
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "telemetry_reader.hpp"
+#include "telemetry_recorder.hpp"
+
+#include <cstring>
+#include <iostream>
+
+TelemetryReader::TelemetryReader()
+    : file_(nullptr), row_bytes_(0), start_unix_ns_(0), rows_left_(0), dropped_(0)
+{
+}
+
+TelemetryReader::~TelemetryReader()
+{
+    this->Close();
+}
+
+bool TelemetryReader::Open(const std::string &path)
+{
+    this->Close();
+
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        std::cout << "\033[0;31m[TelemetryReader]\033[0m Failed to open " << path << std::endl;
+        return false;
+    }
+
+    char magic[8];
+    uint32_t header[4];
+    int64_t start_unix_ns = 0;
+    if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic) || std::memcmp(magic, "RLTELEM1", sizeof(magic)) != 0 ||
+        std::fread(header, sizeof(uint32_t), 4, file) != 4 || header[0] != TelemetryRecorder::kVersion ||
+        std::fread(&start_unix_ns, sizeof(start_unix_ns), 1, file) != 1)
+    {
+        std::cout << "\033[0;31m[TelemetryReader]\033[0m " << path << " is not a telemetry recording" << std::endl;
+        std::fclose(file);
+        return false;
+    }
+
+    std::vector<std::string> columns(header[1]);
+    for (std::string &name : columns)
+    {
+        uint32_t length = 0;
+        if (std::fread(&length, sizeof(length), 1, file) != 1)
+        {
+            std::fclose(file);
+            return false;
+        }
+        name.resize(length);
+        if (length > 0 && std::fread(&name[0], 1, length, file) != length)
+        {
+            std::fclose(file);
+            return false;
+        }
+    }
+    if (header[2] != 2 * sizeof(uint64_t) + columns.size() * sizeof(double))
+    {
+        std::cout << "\033[0;31m[TelemetryReader]\033[0m " << path << " has an unexpected row size" << std::endl;
+        std::fclose(file);
+        return false;
+    }
+
+    this->file_ = file;
+    this->columns_ = columns;
+    this->row_bytes_ = header[2];
+    this->start_unix_ns_ = start_unix_ns;
+    this->rows_left_ = 0;
+    this->dropped_ = 0;
+    this->row_.resize(this->row_bytes_);
+    return true;
+}
+
+void TelemetryReader::Close()
+{
+    if (this->file_)
+    {
+        std::fclose(this->file_);
+        this->file_ = nullptr;
+    }
+}
+
+int TelemetryReader::FindColumn(const std::string &name) const
+{
+    for (size_t i = 0; i < this->columns_.size(); ++i)
+    {
+        if (this->columns_[i] == name)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool TelemetryReader::Next(uint64_t &tick, int64_t &stamp_ns, double *values)
+{
+    if (!this->file_)
+    {
+        return false;
+    }
+    while (this->rows_left_ == 0)
+    {
+        uint32_t chunk_header[2];
+        uint64_t dropped = 0;
+        if (std::fread(chunk_header, sizeof(uint32_t), 2, this->file_) != 2 || chunk_header[0] != TelemetryRecorder::kChunkMagic ||
+            std::fread(&dropped, sizeof(dropped), 1, this->file_) != 1)
+        {
+            return false;
+        }
+        this->rows_left_ = chunk_header[1];
+        this->dropped_ = dropped;
+    }
+    if (std::fread(this->row_.data(), 1, this->row_bytes_, this->file_) != this->row_bytes_)
+    {
+        return false;
+    }
+    --this->rows_left_;
+
+    std::memcpy(&tick, this->row_.data(), sizeof(tick));
+    std::memcpy(&stamp_ns, this->row_.data() + sizeof(tick), sizeof(stamp_ns));
+    std::memcpy(values, this->row_.data() + sizeof(tick) + sizeof(stamp_ns), this->columns_.size() * sizeof(double));
+    return true;
+}
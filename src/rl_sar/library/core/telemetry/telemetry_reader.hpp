@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TELEMETRY_READER_HPP
+#define TELEMETRY_READER_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Sequential reader for files written by TelemetryRecorder, see telemetry_recorder.hpp for the layout.
+ *
+ * Rows are read one at a time straight from the file, so recordings of any length replay in constant memory.
+ */
+class TelemetryReader
+{
+public:
+    TelemetryReader();
+    ~TelemetryReader();
+
+    TelemetryReader(const TelemetryReader &) = delete;
+    TelemetryReader &operator=(const TelemetryReader &) = delete;
+
+    bool Open(const std::string &path);
+    void Close();
+    bool IsOpen() const { return file_ != nullptr; }
+
+    const std::vector<std::string> &Columns() const { return columns_; }
+    size_t Width() const { return columns_.size(); }
+    // Column index by name, -1 if the recording has no such column
+    int FindColumn(const std::string &name) const;
+    int64_t StartUnixNs() const { return start_unix_ns_; }
+    // Rows the recorder dropped before the chunk that is being read
+    uint64_t Dropped() const { return dropped_; }
+
+    // Reads the next row into Width() doubles, false at the end of the file or at a truncated chunk
+    bool Next(uint64_t &tick, int64_t &stamp_ns, double *values);
+
+private:
+    std::FILE *file_;
+    std::vector<std::string> columns_;
+    size_t row_bytes_;
+    int64_t start_unix_ns_;
+    uint32_t rows_left_;   // rows remaining in the current chunk
+    uint64_t dropped_;
+    std::vector<unsigned char> row_;
+};
+
+#endif // TELEMETRY_READER_HPP
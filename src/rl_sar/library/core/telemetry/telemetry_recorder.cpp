@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "telemetry_recorder.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+TelemetryRecorder::TelemetryRecorder()
+    : file_(nullptr), row_bytes_(0), capacity_(0), chunk_rows_(0), flush_interval_(0.1),
+      head_(0), tail_(0), dropped_(0), written_(0), pending_(false), running_(false)
+{
+}
+
+TelemetryRecorder::~TelemetryRecorder()
+{
+    this->Close();
+}
+
+bool TelemetryRecorder::Open(const std::string &path, const std::vector<std::string> &columns,
+                             size_t ring_rows, size_t chunk_rows, double flush_interval)
+{
+    this->Close();
+
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        std::cout << "\033[0;31m[TelemetryRecorder]\033[0m Failed to open " << path << std::endl;
+        return false;
+    }
+
+    this->path_ = path;
+    this->columns_ = columns;
+    this->row_bytes_ = sizeof(RowHeader) + columns.size() * sizeof(double);
+    this->capacity_ = 1;
+    while (this->capacity_ < ring_rows) this->capacity_ <<= 1;
+    this->chunk_rows_ = chunk_rows > 0 ? chunk_rows : 1;
+    this->flush_interval_ = std::chrono::duration<double>(flush_interval);
+    this->ring_.reset(new uint64_t[this->capacity_ * this->row_bytes_ / sizeof(uint64_t)]());
+    this->head_.store(0, std::memory_order_relaxed);
+    this->tail_.store(0, std::memory_order_relaxed);
+    this->dropped_.store(0, std::memory_order_relaxed);
+    this->written_.store(0, std::memory_order_relaxed);
+    this->pending_ = false;
+
+    const char magic[8] = {'R', 'L', 'T', 'E', 'L', 'E', 'M', '1'};
+    const uint32_t header[4] = {kVersion, static_cast<uint32_t>(columns.size()), static_cast<uint32_t>(this->row_bytes_), 0};
+    const int64_t start_unix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::fwrite(magic, 1, sizeof(magic), file);
+    std::fwrite(header, sizeof(uint32_t), 4, file);
+    std::fwrite(&start_unix_ns, sizeof(start_unix_ns), 1, file);
+    for (const std::string &name : columns)
+    {
+        const uint32_t length = static_cast<uint32_t>(name.size());
+        std::fwrite(&length, sizeof(length), 1, file);
+        std::fwrite(name.data(), 1, name.size(), file);
+    }
+    std::fflush(file);
+
+    this->start_ = std::chrono::steady_clock::now();
+    this->file_ = file;
+    this->running_ = true;
+    this->writer_ = std::thread(&TelemetryRecorder::WriterLoop, this);
+
+    std::cout << "[TelemetryRecorder] Recording " << columns.size() << " columns to " << path << std::endl;
+    return true;
+}
+
+void TelemetryRecorder::Close()
+{
+    if (!this->file_)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->running_ = false;
+    }
+    this->cv_.notify_all();
+    if (this->writer_.joinable())
+    {
+        this->writer_.join();
+    }
+    this->Drain();
+    std::fclose(this->file_);
+    this->file_ = nullptr;
+
+    std::cout << "[TelemetryRecorder] Closed " << this->path_ << ": " << this->Written() << " rows written, "
+              << this->Dropped() << " dropped" << std::endl;
+}
+
+double *TelemetryRecorder::Begin(uint64_t tick)
+{
+    if (!this->file_)
+    {
+        return nullptr;
+    }
+    const uint64_t head = this->head_.load(std::memory_order_relaxed);
+    if (head - this->tail_.load(std::memory_order_acquire) >= this->capacity_)
+    {
+        this->dropped_.fetch_add(1, std::memory_order_relaxed);
+        this->pending_ = false;
+        return nullptr;
+    }
+
+    unsigned char *row = reinterpret_cast<unsigned char *>(this->ring_.get()) + (head & (this->capacity_ - 1)) * this->row_bytes_;
+    RowHeader *header = reinterpret_cast<RowHeader *>(row);
+    header->tick = tick;
+    header->stamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->start_).count();
+    this->pending_ = true;
+    return reinterpret_cast<double *>(row + sizeof(RowHeader));
+}
+
+void TelemetryRecorder::Commit()
+{
+    if (!this->pending_)
+    {
+        return;
+    }
+    this->pending_ = false;
+    this->head_.store(this->head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void TelemetryRecorder::WriterLoop()
+{
+    std::unique_lock<std::mutex> lock(this->mutex_);
+    while (this->running_)
+    {
+        this->cv_.wait_for(lock, this->flush_interval_);
+        lock.unlock();
+        this->Drain();
+        lock.lock();
+    }
+}
+
+size_t TelemetryRecorder::Drain()
+{
+    const unsigned char *ring = reinterpret_cast<const unsigned char *>(this->ring_.get());
+    const uint64_t head = this->head_.load(std::memory_order_acquire);
+    uint64_t tail = this->tail_.load(std::memory_order_relaxed);
+    size_t total = 0;
+
+    while (tail < head)
+    {
+        // A chunk never wraps around the end of the ring so its rows go out in one fwrite
+        const size_t index = tail & (this->capacity_ - 1);
+        size_t rows = std::min<uint64_t>(head - tail, this->chunk_rows_);
+        rows = std::min(rows, this->capacity_ - index);
+
+        const uint32_t chunk_header[2] = {kChunkMagic, static_cast<uint32_t>(rows)};
+        const uint64_t dropped = this->dropped_.load(std::memory_order_relaxed);
+        std::fwrite(chunk_header, sizeof(uint32_t), 2, this->file_);
+        std::fwrite(&dropped, sizeof(dropped), 1, this->file_);
+        std::fwrite(ring + index * this->row_bytes_, this->row_bytes_, rows, this->file_);
+
+        tail += rows;
+        total += rows;
+        this->tail_.store(tail, std::memory_order_release);
+    }
+
+    if (total > 0)
+    {
+        std::fflush(this->file_);
+        this->written_.fetch_add(total, std::memory_order_relaxed);
+    }
+    return total;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TELEMETRY_RECORDER_HPP
+#define TELEMETRY_RECORDER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Full-rate binary telemetry: one real-time producer thread, one background writer thread.
+ *
+ * The producer claims a fixed-width row in a preallocated single-producer/single-consumer ring with
+ * Begin(), fills Width() doubles and publishes it with Commit(). Neither call allocates, locks or
+ * touches the file, a full ring drops the row and counts it. The writer thread drains the ring every
+ * flush interval and appends the rows to the file in chunks.
+ *
+ * File layout, little endian, see scripts/telemetry_to_csv.py:
+ *   header  char magic[8] = "RLTELEM1", uint32 version, uint32 num_columns, uint32 row_bytes,
+ *           uint32 reserved, int64 start_unix_ns, then num_columns x (uint32 length, char name[length])
+ *   chunk   uint32 magic = kChunkMagic, uint32 num_rows, uint64 dropped (total so far),
+ *           then num_rows rows
+ *   row     uint64 tick, int64 stamp_ns (steady clock since Open), double values[num_columns]
+ */
+class TelemetryRecorder
+{
+public:
+    static const uint32_t kVersion = 1;
+    static const uint32_t kChunkMagic = 0x4B484354;  // "TCHK"
+
+    TelemetryRecorder();
+    ~TelemetryRecorder();
+
+    TelemetryRecorder(const TelemetryRecorder &) = delete;
+    TelemetryRecorder &operator=(const TelemetryRecorder &) = delete;
+
+    // ring_rows is rounded up to a power of two, chunk_rows bounds the rows per file chunk
+    bool Open(const std::string &path, const std::vector<std::string> &columns,
+              size_t ring_rows = 8192, size_t chunk_rows = 1024, double flush_interval = 0.1);
+    // Stops the writer thread after draining everything committed so far
+    void Close();
+    bool IsOpen() const { return file_ != nullptr; }
+
+    // Producer side: returns Width() doubles to fill, or nullptr when closed or the ring is full
+    double *Begin(uint64_t tick);
+    void Commit();
+    size_t Width() const { return columns_.size(); }
+
+    uint64_t Recorded() const { return head_.load(std::memory_order_relaxed); }
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t Written() const { return written_.load(std::memory_order_relaxed); }
+
+private:
+    struct RowHeader
+    {
+        uint64_t tick;
+        int64_t stamp_ns;
+    };
+
+    void WriterLoop();
+    size_t Drain();
+
+    std::FILE *file_;
+    std::string path_;
+    std::vector<std::string> columns_;
+    size_t row_bytes_;
+    size_t capacity_;   // power of two
+    size_t chunk_rows_;
+    std::chrono::duration<double> flush_interval_;
+    std::chrono::steady_clock::time_point start_;
+    std::unique_ptr<uint64_t[]> ring_;  // uint64_t keeps every row 8-byte aligned
+
+    // head_ is written by the producer only, tail_ by the writer only
+    alignas(64) std::atomic<uint64_t> head_;
+    alignas(64) std::atomic<uint64_t> tail_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> written_;
+    bool pending_;
+
+    std::thread writer_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool running_;
+};
+
+#endif // TELEMETRY_RECORDER_HPP
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Wait-free latest-value handoff between one writer thread and one reader thread.
+ *
+ * Three slots rotate between the writer (back), the reader (front) and a shared middle slot. Publishing
+ * and updating are a single atomic exchange each, neither side ever waits for the other and the reader
+ * reads its front slot in place without copying it. Intermediate values are dropped when the writer is
+ * faster than the reader.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    struct Slot
+    {
+        T value{};
+        uint64_t sequence = 0;                           // 0 until the first publish
+        std::chrono::steady_clock::time_point stamp{};  // when the value was published
+    };
+
+    TripleBuffer() : back_(0), front_(1), middle_(2), sequence_(0) {}
+
+    // Writer side: fill WriteBuffer() and Publish() it, or Write() a copy
+    T &WriteBuffer() { return slots_[back_].slot.value; }
+
+    void Publish()
+    {
+        Slot &slot = slots_[back_].slot;
+        slot.sequence = ++sequence_;
+        slot.stamp = std::chrono::steady_clock::now();
+        back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    void Write(const T &value)
+    {
+        WriteBuffer() = value;
+        Publish();
+    }
+
+    // Reader side: Update() takes the newest published slot if there is one, Read() stays valid until the next Update()
+    bool Update()
+    {
+        if (!(middle_.load(std::memory_order_relaxed) & kFresh))
+        {
+            return false;
+        }
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+
+    const Slot &Read() const { return slots_[front_].slot; }
+
+private:
+    static const uint8_t kIndexMask = 0x3;
+    static const uint8_t kFresh = 0x4;
+
+    struct alignas(64) PaddedSlot
+    {
+        Slot slot;
+    };
+
+    PaddedSlot slots_[3];
+    uint8_t back_;                  // writer only
+    uint8_t front_;                 // reader only
+    std::atomic<uint8_t> middle_;   // index of the shared slot, kFresh while the reader has not taken it
+    uint64_t sequence_;             // writer only
+};
+
+#endif // TRIPLE_BUFFER_HPP
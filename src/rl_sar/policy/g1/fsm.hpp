@@ -12,10 +12,72 @@
 namespace g1_fsm
 {
 
+using K = Input::Keyboard;
+using G = Input::Gamepad;
+
+// Transition tables, checked in order, the first active entry wins. A state listing itself just stays.
+const std::vector<RLFSMState::KeyTransition> kPassiveTransitions = {
+    {K::Num0, G::A, "RLFSMStateGetUp"},
+};
+
+const std::vector<RLFSMState::KeyTransition> kGetUpTransitions = {
+    {K::P, G::LB_X, "RLFSMStatePassive"},
+};
+
+// only once standing up has finished
+const std::vector<RLFSMState::KeyTransition> kGetUpDoneTransitions = {
+    // {K::Num1, G::RB_DPadUp, "RLFSMStateRL_Locomotion"},
+    {K::Num2, G::RB_DPadDown, "RLFSMStateRL_RoboMimicLoco"},
+    // {K::Num3, G::RB_DPadLeft, "RLFSMStateRL_RoboMimicDance"},
+    // {K::Num4, G::RB_DPadRight, "RLFSMStateRL_RoboMimicKungFu"},
+    // {K::Num5, G::LB_DPadUp, "RLFSMStateRL_RoboMimicKick"},
+    {K::Num9, G::B, "RLFSMStateGetDown"},
+};
+
+const std::vector<RLFSMState::KeyTransition> kGetDownTransitions = {
+    {K::P, G::LB_X, "RLFSMStatePassive"},
+    {K::Num0, G::A, "RLFSMStateGetUp"},
+};
+
+// Num1-Num5 pick a policy
+const std::vector<RLFSMState::KeyTransition> kPolicySelectTransitions = {
+    {K::Num1, G::RB_DPadUp, "RLFSMStateRL_Locomotion"},
+    {K::Num2, G::RB_DPadDown, "RLFSMStateRL_RoboMimicLoco"},
+    {K::Num3, G::RB_DPadLeft, "RLFSMStateRL_RoboMimicDance"},
+    {K::Num4, G::RB_DPadRight, "RLFSMStateRL_RoboMimicKungFu"},
+    {K::Num5, G::LB_DPadUp, "RLFSMStateRL_RoboMimicKick"},
+};
+
+const std::vector<RLFSMState::KeyTransition> kLocomotionTransitions = {
+    {K::P, G::LB_X, "RLFSMStatePassive"},
+    {K::Num9, G::B, "RLFSMStateGetDown"},
+    {K::Num0, G::A, "RLFSMStateGetUp"},
+};
+
+// B on the gamepad is passive rather than get down in the RoboMimic loco and dance policies
+const std::vector<RLFSMState::KeyTransition> kRoboMimicTransitions = {
+    {K::P, G::LB_X, "RLFSMStatePassive"},
+    {K::None, G::B, "RLFSMStatePassive"},
+    {K::Num9, G::None, "RLFSMStateGetDown"},
+    {K::Num0, G::A, "RLFSMStateGetUp"},
+};
+
+const std::vector<RLFSMState::KeyTransition> kDanceTransitions = {
+    {K::Num2, G::RB_DPadDown, "RLFSMStateRL_RoboMimicLoco"},
+    // {K::Num1, G::RB_DPadUp, "RLFSMStateRL_Locomotion"},
+};
+
+const std::vector<RLFSMState::KeyTransition> kMotionTransitions = {
+    {K::Num1, G::RB_DPadUp, "RLFSMStateRL_Locomotion"},
+};
+
 class RLFSMStatePassive : public RLFSMState
 {
 public:
-    RLFSMStatePassive(RL *rl) : RLFSMState(*rl, "RLFSMStatePassive") {}
+    RLFSMStatePassive(RL *rl) : RLFSMState(*rl, "RLFSMStatePassive")
+    {
+        AddTransitions(kPassiveTransitions);
+    }
 
     void Enter() override
     {
@@ -36,21 +98,16 @@ public:
     }
 
     void Exit() override {}
-
-    std::string CheckChange() override
-    {
-        if (rl.control.current_keyboard == Input::Keyboard::Num0 || rl.control.current_gamepad == Input::Gamepad::A)
-        {
-            return "RLFSMStateGetUp";
-        }
-        return state_name_;
-    }
 };
 
 class RLFSMStateGetUp : public RLFSMState
 {
 public:
-    RLFSMStateGetUp(RL *rl) : RLFSMState(*rl, "RLFSMStateGetUp") {}
+    RLFSMStateGetUp(RL *rl) : RLFSMState(*rl, "RLFSMStateGetUp")
+    {
+        AddTransitions(kGetUpTransitions);
+        AddTransitions(kGetUpDoneTransitions, [this]() { return rl.running_percent == 1.0f; });
+    }
 
     void Enter() override
     {
@@ -68,59 +125,26 @@ public:
 
             for (int i = 0; i < rl.params.num_of_dofs; ++i)
             {
-                fsm_command->motor_command.q[i] = (1 - rl.running_percent) * rl.now_state.motor_state.q[i] + rl.running_percent * rl.params.default_dof_pos[0][i].item<double>();
+                fsm_command->motor_command.q[i] = (1 - rl.running_percent) * rl.now_state.motor_state.q[i] + rl.running_percent * rl.params.joint.default_dof_pos[i];
                 fsm_command->motor_command.dq[i] = 0;
-                fsm_command->motor_command.kp[i] = rl.params.fixed_kp[0][i].item<double>();
-                fsm_command->motor_command.kd[i] = rl.params.fixed_kd[0][i].item<double>();
+                fsm_command->motor_command.kp[i] = rl.params.joint.fixed_kp[i];
+                fsm_command->motor_command.kd[i] = rl.params.joint.fixed_kd[i];
                 fsm_command->motor_command.tau[i] = 0;
             }
-            std::cout << "\r\033[K" << std::flush << LOGGER::INFO << "Getting up " << std::fixed << std::setprecision(2) << rl.running_percent * 100.0f << "%" << std::flush;
         }
     }
 
     void Exit() override {}
-
-    std::string CheckChange() override
-    {
-        if (rl.control.current_keyboard == Input::Keyboard::P || rl.control.current_gamepad == Input::Gamepad::LB_X)
-        {
-            return "RLFSMStatePassive";
-        }
-        if (rl.running_percent == 1.0f)
-        {
-            // if (rl.control.current_keyboard == Input::Keyboard::Num1 || rl.control.current_gamepad == Input::Gamepad::RB_DPadUp)
-            // {
-            //     return "RLFSMStateRL_Locomotion";
-            // }
-            if (rl.control.current_keyboard == Input::Keyboard::Num2 || rl.control.current_gamepad == Input::Gamepad::RB_DPadDown)
-            {
-                return "RLFSMStateRL_RoboMimicLoco";
-            }
-            // else if (rl.control.current_keyboard == Input::Keyboard::Num3 || rl.control.current_gamepad == Input::Gamepad::RB_DPadLeft)
-            // {
-            //     return "RLFSMStateRL_RoboMimicDance";
-            // }
-            // else if (rl.control.current_keyboard == Input::Keyboard::Num4 || rl.control.current_gamepad == Input::Gamepad::RB_DPadRight)
-            // {
-            //     return "RLFSMStateRL_RoboMimicKungFu";
-            // }
-            // else if (rl.control.current_keyboard == Input::Keyboard::Num5 || rl.control.current_gamepad == Input::Gamepad::LB_DPadUp)
-            // {
-            //     return "RLFSMStateRL_RoboMimicKick";
-            // }
-            else if (rl.control.current_keyboard == Input::Keyboard::Num9 || rl.control.current_gamepad == Input::Gamepad::B)
-            {
-                return "RLFSMStateGetDown";
-            }
-        }
-        return state_name_;
-    }
 };
 
 class RLFSMStateGetDown : public RLFSMState
 {
 public:
-    RLFSMStateGetDown(RL *rl) : RLFSMState(*rl, "RLFSMStateGetDown") {}
+    RLFSMStateGetDown(RL *rl) : RLFSMState(*rl, "RLFSMStateGetDown")
+    {
+        AddTransition([this]() { return rl.running_percent == 1.0f; }, "RLFSMStatePassive");
+        AddTransitions(kGetDownTransitions);
+    }
 
     void Enter() override
     {
@@ -139,41 +163,31 @@ public:
             {
                 fsm_command->motor_command.q[i] = (1 - rl.running_percent) * rl.now_state.motor_state.q[i] + rl.running_percent * rl.start_state.motor_state.q[i];
                 fsm_command->motor_command.dq[i] = 0;
-                fsm_command->motor_command.kp[i] = rl.params.fixed_kp[0][i].item<double>();
-                fsm_command->motor_command.kd[i] = rl.params.fixed_kd[0][i].item<double>();
+                fsm_command->motor_command.kp[i] = rl.params.joint.fixed_kp[i];
+                fsm_command->motor_command.kd[i] = rl.params.joint.fixed_kd[i];
                 fsm_command->motor_command.tau[i] = 0;
             }
-            std::cout << "\r\033[K" << std::flush << LOGGER::INFO << "Getting down "<< std::fixed << std::setprecision(2) << rl.running_percent * 100.0f << "%" << std::flush;
         }
     }
 
     void Exit() override {}
-
-    std::string CheckChange() override
-    {
-        if (rl.control.current_keyboard == Input::Keyboard::P || rl.control.current_gamepad == Input::Gamepad::LB_X || rl.running_percent == 1.0f)
-        {
-            return "RLFSMStatePassive";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num0 || rl.control.current_gamepad == Input::Gamepad::A)
-        {
-            return "RLFSMStateGetUp";
-        }
-        return state_name_;
-    }
 };
 
 class RLFSMStateRL_Locomotion : public RLFSMState
 {
 public:
-    RLFSMStateRL_Locomotion(RL *rl) : RLFSMState(*rl, "RLFSMStateRL_Locomotion") {}
+    RLFSMStateRL_Locomotion(RL *rl) : RLFSMState(*rl, "RLFSMStateRL_Locomotion", "unitree_rl_gym")
+    {
+        AddTransitions(kLocomotionTransitions);
+        AddTransitions(kPolicySelectTransitions);
+    }
 
     void Enter() override
     {
         rl.episode_length_buf = 0;
 
         // read params from yaml
-        rl.config_name = "unitree_rl_gym";
+        rl.config_name = policy_config;
         std::string robot_path = rl.robot_name + "/" + rl.config_name;
         try
         {
@@ -192,23 +206,15 @@ public:
 
     void Run() override
     {
-        std::cout << "\r\033[K" << std::flush << LOGGER::INFO << "RL Controller x:" << rl.control.x << " y:" << rl.control.y << " yaw:" << rl.control.yaw << std::flush;
-
-        torch::Tensor _output_dof_pos, _output_dof_vel;
-        if (rl.output_dof_pos_queue.try_pop(_output_dof_pos) && rl.output_dof_vel_queue.try_pop(_output_dof_vel))
+        if (rl.output_mailbox.Update())
         {
-            for (int i = 0; i < rl.params.num_of_dofs; ++i)
+            const PolicyOutput &output = rl.output_mailbox.Read().value;
+            for (int i = 0; i < output.num_of_dofs; ++i)
             {
-                if (_output_dof_pos.defined() && _output_dof_pos.numel() > 0)
-                {
-                    fsm_command->motor_command.q[i] = rl.output_dof_pos[0][i].item<double>();
-                }
-                if (_output_dof_vel.defined() && _output_dof_vel.numel() > 0)
-                {
-                    fsm_command->motor_command.dq[i] = rl.output_dof_vel[0][i].item<double>();
-                }
-                fsm_command->motor_command.kp[i] = rl.params.rl_kp[0][i].item<double>();
-                fsm_command->motor_command.kd[i] = rl.params.rl_kd[0][i].item<double>();
+                fsm_command->motor_command.q[i] = output.dof_pos[i];
+                fsm_command->motor_command.dq[i] = output.dof_vel[i];
+                fsm_command->motor_command.kp[i] = output.kp[i];
+                fsm_command->motor_command.kd[i] = output.kd[i];
                 fsm_command->motor_command.tau[i] = 0;
             }
         }
@@ -218,56 +224,23 @@ public:
     {
         rl.rl_init_done = false;
     }
-
-    std::string CheckChange() override
-    {
-        if (rl.control.current_keyboard == Input::Keyboard::P || rl.control.current_gamepad == Input::Gamepad::LB_X)
-        {
-            return "RLFSMStatePassive";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num9 || rl.control.current_gamepad == Input::Gamepad::B)
-        {
-            return "RLFSMStateGetDown";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num0 || rl.control.current_gamepad == Input::Gamepad::A)
-        {
-            return "RLFSMStateGetUp";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num1 || rl.control.current_gamepad == Input::Gamepad::RB_DPadUp)
-        {
-            return "RLFSMStateRL_Locomotion";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num2 || rl.control.current_gamepad == Input::Gamepad::RB_DPadDown)
-        {
-            return "RLFSMStateRL_RoboMimicLoco";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num3 || rl.control.current_gamepad == Input::Gamepad::RB_DPadLeft)
-        {
-            return "RLFSMStateRL_RoboMimicDance";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num4 || rl.control.current_gamepad == Input::Gamepad::RB_DPadRight)
-        {
-            return "RLFSMStateRL_RoboMimicKungFu";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num5 || rl.control.current_gamepad == Input::Gamepad::LB_DPadUp)
-        {
-            return "RLFSMStateRL_RoboMimicKick";
-        }
-        return state_name_;
-    }
 };
 
 class RLFSMStateRL_RoboMimicLoco : public RLFSMState
 {
 public:
-    RLFSMStateRL_RoboMimicLoco(RL *rl) : RLFSMState(*rl, "RLFSMStateRL_RoboMimicLoco") {}
+    RLFSMStateRL_RoboMimicLoco(RL *rl) : RLFSMState(*rl, "RLFSMStateRL_RoboMimicLoco", "robomimic/loco")
+    {
+        AddTransitions(kRoboMimicTransitions);
+        AddTransitions(kPolicySelectTransitions);
+    }
 
     void Enter() override
     {
         rl.episode_length_buf = 0;
 
         // read params from yaml
-        rl.config_name = "robomimic/loco";
+        rl.config_name = policy_config;
         std::string robot_path = rl.robot_name + "/" + rl.config_name;
         try
         {
@@ -286,23 +259,15 @@ public:
 
     void Run() override
     {
-        std::cout << "\r\033[K" << std::flush << LOGGER::INFO << "RL Controller x:" << rl.control.x << " y:" << rl.control.y << " yaw:" << rl.control.yaw << std::flush;
-
-        torch::Tensor _output_dof_pos, _output_dof_vel;
-        if (rl.output_dof_pos_queue.try_pop(_output_dof_pos) && rl.output_dof_vel_queue.try_pop(_output_dof_vel))
+        if (rl.output_mailbox.Update())
         {
-            for (int i = 0; i < rl.params.num_of_dofs; ++i)
+            const PolicyOutput &output = rl.output_mailbox.Read().value;
+            for (int i = 0; i < output.num_of_dofs; ++i)
             {
-                if (_output_dof_pos.defined() && _output_dof_pos.numel() > 0)
-                {
-                    fsm_command->motor_command.q[i] = rl.output_dof_pos[0][i].item<double>();
-                }
-                if (_output_dof_vel.defined() && _output_dof_vel.numel() > 0)
-                {
-                    fsm_command->motor_command.dq[i] = rl.output_dof_vel[0][i].item<double>();
-                }
-                fsm_command->motor_command.kp[i] = rl.params.rl_kp[0][i].item<double>();
-                fsm_command->motor_command.kd[i] = rl.params.rl_kd[0][i].item<double>();
+                fsm_command->motor_command.q[i] = output.dof_pos[i];
+                fsm_command->motor_command.dq[i] = output.dof_vel[i];
+                fsm_command->motor_command.kp[i] = output.kp[i];
+                fsm_command->motor_command.kd[i] = output.kd[i];
                 fsm_command->motor_command.tau[i] = 0;
             }
         }
@@ -312,56 +277,23 @@ public:
     {
         rl.rl_init_done = false;
     }
-
-    std::string CheckChange() override
-    {
-        if (rl.control.current_keyboard == Input::Keyboard::P || rl.control.current_gamepad == Input::Gamepad::LB_X || rl.control.current_gamepad == Input::Gamepad::B)
-        {
-            return "RLFSMStatePassive";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num9 )
-        {
-            return "RLFSMStateGetDown";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num0 || rl.control.current_gamepad == Input::Gamepad::A)
-        {
-            return "RLFSMStateGetUp";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num1 || rl.control.current_gamepad == Input::Gamepad::RB_DPadUp)
-        {
-            return "RLFSMStateRL_Locomotion";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num2 || rl.control.current_gamepad == Input::Gamepad::RB_DPadDown)
-        {
-            return "RLFSMStateRL_RoboMimicLoco";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num3 || rl.control.current_gamepad == Input::Gamepad::RB_DPadLeft)
-        {
-            return "RLFSMStateRL_RoboMimicDance";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num4 || rl.control.current_gamepad == Input::Gamepad::RB_DPadRight)
-        {
-            return "RLFSMStateRL_RoboMimicKungFu";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num5 || rl.control.current_gamepad == Input::Gamepad::LB_DPadUp)
-        {
-            return "RLFSMStateRL_RoboMimicKick";
-        }
-        return state_name_;
-    }
 };
 
 class RLFSMStateRL_RoboMimicDance : public RLFSMState
 {
 public:
-RLFSMStateRL_RoboMimicDance(RL *rl) : RLFSMState(*rl, "RLFSMStateRL_RoboMimicDance") {}
+RLFSMStateRL_RoboMimicDance(RL *rl) : RLFSMState(*rl, "RLFSMStateRL_RoboMimicDance", "robomimic/beyonddance")
+{
+    AddTransitions(kRoboMimicTransitions);
+    AddTransitions(kDanceTransitions);
+}
 
 void Enter() override
 {
     rl.episode_length_buf = 0;
 
     // read params from yaml
-    rl.config_name = "robomimic/beyonddance";
+    rl.config_name = policy_config;
     std::string robot_path = rl.robot_name + "/" + rl.config_name;
     try
     {
@@ -384,24 +316,16 @@ void Enter() override
     {
         float motion_time = rl.episode_length_buf * rl.params.dt * rl.params.decimation;
         motion_time = fmin(motion_time, rl.motion_length);
-        // float running_progress = motion_time / rl.motion_length * 100.0f;
-        // std::cout << "\r\033[K" << std::flush << LOGGER::INFO << "Running progress "<< std::fixed << std::setprecision(2) << running_progress << "%" << std::flush;
 
-        torch::Tensor _output_dof_pos, _output_dof_vel;
-        if (rl.output_dof_pos_queue.try_pop(_output_dof_pos) && rl.output_dof_vel_queue.try_pop(_output_dof_vel))
+        if (rl.output_mailbox.Update())
         {
-            for (int i = 0; i < rl.params.num_of_dofs; ++i)
+            const PolicyOutput &output = rl.output_mailbox.Read().value;
+            for (int i = 0; i < output.num_of_dofs; ++i)
             {
-                if (_output_dof_pos.defined() && _output_dof_pos.numel() > 0)
-                {
-                    fsm_command->motor_command.q[i] = rl.output_dof_pos[0][i].item<double>();
-                }
-                if (_output_dof_vel.defined() && _output_dof_vel.numel() > 0)
-                {
-                    fsm_command->motor_command.dq[i] = rl.output_dof_vel[0][i].item<double>();
-                }
-                fsm_command->motor_command.kp[i] = rl.params.rl_kp[0][i].item<double>();
-                fsm_command->motor_command.kd[i] = rl.params.rl_kd[0][i].item<double>();
+                fsm_command->motor_command.q[i] = output.dof_pos[i];
+                fsm_command->motor_command.dq[i] = output.dof_vel[i];
+                fsm_command->motor_command.kp[i] = output.kp[i];
+                fsm_command->motor_command.kd[i] = output.kd[i];
                 fsm_command->motor_command.tau[i] = 0;
             }
         }
@@ -416,44 +340,23 @@ void Enter() override
     {
         rl.rl_init_done = false;
     }
-
-    std::string CheckChange() override
-    {
-        if (rl.control.current_keyboard == Input::Keyboard::P || rl.control.current_gamepad == Input::Gamepad::LB_X|| rl.control.current_gamepad == Input::Gamepad::B)
-        {
-            return "RLFSMStatePassive";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num9 )
-        {
-            return "RLFSMStateGetDown";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num0 || rl.control.current_gamepad == Input::Gamepad::A)
-        {
-            return "RLFSMStateGetUp";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num2 || rl.control.current_gamepad == Input::Gamepad::RB_DPadDown)
-        {
-            return "RLFSMStateRL_RoboMimicLoco";
-        }
-        // else if (rl.control.current_keyboard == Input::Keyboard::Num1 || rl.control.current_gamepad == Input::Gamepad::RB_DPadUp)
-        // {
-        //     return "RLFSMStateRL_Locomotion";
-        // }
-        return state_name_;
-    }
 };
 
 class RLFSMStateRL_RoboMimicKungFu : public RLFSMState
 {
 public:
-    RLFSMStateRL_RoboMimicKungFu(RL *rl) : RLFSMState(*rl, "RLFSMStateRL_RoboMimicKungFu") {}
+    RLFSMStateRL_RoboMimicKungFu(RL *rl) : RLFSMState(*rl, "RLFSMStateRL_RoboMimicKungFu", "robomimic/kungfu")
+    {
+        AddTransitions(kLocomotionTransitions);
+        AddTransitions(kMotionTransitions);
+    }
 
     void Enter() override
     {
         rl.episode_length_buf = 0;
 
         // read params from yaml
-        rl.config_name = "robomimic/kungfu";
+        rl.config_name = policy_config;
         std::string robot_path = rl.robot_name + "/" + rl.config_name;
         try
         {
@@ -476,24 +379,16 @@ public:
     {
         float motion_time = rl.episode_length_buf * rl.params.dt * rl.params.decimation;
         motion_time = fmin(motion_time, rl.motion_length);
-        float running_progress = motion_time / rl.motion_length * 100.0f;
-        std::cout << "\r\033[K" << std::flush << LOGGER::INFO << "Running progress "<< std::fixed << std::setprecision(2) << running_progress << "%" << std::flush;
 
-        torch::Tensor _output_dof_pos, _output_dof_vel;
-        if (rl.output_dof_pos_queue.try_pop(_output_dof_pos) && rl.output_dof_vel_queue.try_pop(_output_dof_vel))
+        if (rl.output_mailbox.Update())
         {
-            for (int i = 0; i < rl.params.num_of_dofs; ++i)
+            const PolicyOutput &output = rl.output_mailbox.Read().value;
+            for (int i = 0; i < output.num_of_dofs; ++i)
             {
-                if (_output_dof_pos.defined() && _output_dof_pos.numel() > 0)
-                {
-                    fsm_command->motor_command.q[i] = rl.output_dof_pos[0][i].item<double>();
-                }
-                if (_output_dof_vel.defined() && _output_dof_vel.numel() > 0)
-                {
-                    fsm_command->motor_command.dq[i] = rl.output_dof_vel[0][i].item<double>();
-                }
-                fsm_command->motor_command.kp[i] = rl.params.rl_kp[0][i].item<double>();
-                fsm_command->motor_command.kd[i] = rl.params.rl_kd[0][i].item<double>();
+                fsm_command->motor_command.q[i] = output.dof_pos[i];
+                fsm_command->motor_command.dq[i] = output.dof_vel[i];
+                fsm_command->motor_command.kp[i] = output.kp[i];
+                fsm_command->motor_command.kd[i] = output.kd[i];
                 fsm_command->motor_command.tau[i] = 0;
             }
         }
@@ -508,40 +403,23 @@ public:
     {
         rl.rl_init_done = false;
     }
-
-    std::string CheckChange() override
-    {
-        if (rl.control.current_keyboard == Input::Keyboard::P || rl.control.current_gamepad == Input::Gamepad::LB_X)
-        {
-            return "RLFSMStatePassive";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num9 || rl.control.current_gamepad == Input::Gamepad::B)
-        {
-            return "RLFSMStateGetDown";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num0 || rl.control.current_gamepad == Input::Gamepad::A)
-        {
-            return "RLFSMStateGetUp";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num1 || rl.control.current_gamepad == Input::Gamepad::RB_DPadUp)
-        {
-            return "RLFSMStateRL_Locomotion";
-        }
-        return state_name_;
-    }
 };
 
 class RLFSMStateRL_RoboMimicKick : public RLFSMState
 {
 public:
-    RLFSMStateRL_RoboMimicKick(RL *rl) : RLFSMState(*rl, "RLFSMStateRL_RoboMimicKick") {}
+    RLFSMStateRL_RoboMimicKick(RL *rl) : RLFSMState(*rl, "RLFSMStateRL_RoboMimicKick", "robomimic/kick")
+    {
+        AddTransitions(kLocomotionTransitions);
+        AddTransitions(kMotionTransitions);
+    }
 
     void Enter() override
     {
         rl.episode_length_buf = 0;
 
         // read params from yaml
-        rl.config_name = "robomimic/kick";
+        rl.config_name = policy_config;
         std::string robot_path = rl.robot_name + "/" + rl.config_name;
         try
         {
@@ -564,24 +442,16 @@ public:
     {
         float motion_time = rl.episode_length_buf * rl.params.dt * rl.params.decimation;
         motion_time = fmin(motion_time, rl.motion_length);
-        float running_progress = motion_time / rl.motion_length * 100.0f;
-        std::cout << "\r\033[K" << std::flush << LOGGER::INFO << "Running progress "<< std::fixed << std::setprecision(2) << running_progress << "%" << std::flush;
 
-        torch::Tensor _output_dof_pos, _output_dof_vel;
-        if (rl.output_dof_pos_queue.try_pop(_output_dof_pos) && rl.output_dof_vel_queue.try_pop(_output_dof_vel))
+        if (rl.output_mailbox.Update())
         {
-            for (int i = 0; i < rl.params.num_of_dofs; ++i)
+            const PolicyOutput &output = rl.output_mailbox.Read().value;
+            for (int i = 0; i < output.num_of_dofs; ++i)
             {
-                if (_output_dof_pos.defined() && _output_dof_pos.numel() > 0)
-                {
-                    fsm_command->motor_command.q[i] = rl.output_dof_pos[0][i].item<double>();
-                }
-                if (_output_dof_vel.defined() && _output_dof_vel.numel() > 0)
-                {
-                    fsm_command->motor_command.dq[i] = rl.output_dof_vel[0][i].item<double>();
-                }
-                fsm_command->motor_command.kp[i] = rl.params.rl_kp[0][i].item<double>();
-                fsm_command->motor_command.kd[i] = rl.params.rl_kd[0][i].item<double>();
+                fsm_command->motor_command.q[i] = output.dof_pos[i];
+                fsm_command->motor_command.dq[i] = output.dof_vel[i];
+                fsm_command->motor_command.kp[i] = output.kp[i];
+                fsm_command->motor_command.kd[i] = output.kd[i];
                 fsm_command->motor_command.tau[i] = 0;
             }
         }
@@ -596,27 +466,6 @@ public:
     {
         rl.rl_init_done = false;
     }
-
-    std::string CheckChange() override
-    {
-        if (rl.control.current_keyboard == Input::Keyboard::P || rl.control.current_gamepad == Input::Gamepad::LB_X)
-        {
-            return "RLFSMStatePassive";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num9 || rl.control.current_gamepad == Input::Gamepad::B)
-        {
-            return "RLFSMStateGetDown";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num0 || rl.control.current_gamepad == Input::Gamepad::A)
-        {
-            return "RLFSMStateGetUp";
-        }
-        else if (rl.control.current_keyboard == Input::Keyboard::Num1 || rl.control.current_gamepad == Input::Gamepad::RB_DPadUp)
-        {
-            return "RLFSMStateRL_Locomotion";
-        }
-        return state_name_;
-    }
 };
 
 } // namespace g1_fsm
@@ -661,6 +510,16 @@ public:
         };
     }
     std::string GetInitialState() const override { return initial_state_; }
+    std::vector<std::string> GetPolicies() const override
+    {
+        return {
+            "unitree_rl_gym",
+            "robomimic/loco",
+            "robomimic/beyonddance",
+            "robomimic/kungfu",
+            "robomimic/kick"
+        };
+    }
 private:
     std::string initial_state_;
 };
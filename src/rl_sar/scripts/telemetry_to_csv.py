@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""
+Convert a binary telemetry recording written by TelemetryRecorder to CSV or column files.
+
+Usage:
+    python telemetry_to_csv.py <recording> [--output OUTPUT] [--format {csv,npz,parquet}] [--columns NAME ...]
+
+Examples:
+    python telemetry_to_csv.py policy/g1/motor.rltl
+    python telemetry_to_csv.py policy/g1/motor.rltl --format npz
+    python telemetry_to_csv.py policy/g1/motor.rltl --format parquet --columns tau_est_0 tau_est_1
+
+Every row keeps its tick and stamp_ns (steady clock nanoseconds since the recorder was opened). Rows the
+recorder had to drop are reported from the chunk headers, the tick column shows where they are missing.
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+from array import array
+
+MAGIC = b"RLTELEM1"
+CHUNK_MAGIC = 0x4B484354
+
+
+def read_recording(path):
+    """
+    Read a recording into columns.
+
+    Returns:
+        (columns, info): columns maps tick, stamp_ns and every recorded column name to an array,
+        info holds start_unix_ns, the number of chunks and the dropped row count
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if data[:8] != MAGIC:
+        raise ValueError(f"{path} is not a telemetry recording")
+    version, num_columns, row_bytes, _ = struct.unpack_from("<4I", data, 8)
+    if version != 1:
+        raise ValueError(f"Unsupported telemetry version {version}")
+    (start_unix_ns,) = struct.unpack_from("<q", data, 24)
+    offset = 32
+    names = []
+    for _ in range(num_columns):
+        (length,) = struct.unpack_from("<I", data, offset)
+        offset += 4
+        names.append(data[offset:offset + length].decode("utf-8"))
+        offset += length
+
+    row = struct.Struct(f"<Qq{num_columns}d")
+    if row.size != row_bytes:
+        raise ValueError(f"Row size mismatch: header says {row_bytes} bytes, columns give {row.size}")
+
+    columns = {"tick": array("Q"), "stamp_ns": array("q")}
+    values = [array("d") for _ in names]
+    chunks = 0
+    dropped = 0
+    while offset + 16 <= len(data):
+        magic, num_rows, dropped = struct.unpack_from("<IIQ", data, offset)
+        if magic != CHUNK_MAGIC:
+            raise ValueError(f"Corrupt chunk header at byte {offset}")
+        offset += 16
+        available = (len(data) - offset) // row_bytes
+        if available < num_rows:
+            print(f"Warning: truncated last chunk, keeping {available} of {num_rows} rows", file=sys.stderr)
+            num_rows = available
+        for fields in row.iter_unpack(data[offset:offset + num_rows * row_bytes]):
+            columns["tick"].append(fields[0])
+            columns["stamp_ns"].append(fields[1])
+            for column, value in zip(values, fields[2:]):
+                column.append(value)
+        offset += num_rows * row_bytes
+        chunks += 1
+
+    columns.update(zip(names, values))
+    info = {"start_unix_ns": start_unix_ns, "chunks": chunks, "dropped": dropped}
+    return columns, info
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a TelemetryRecorder recording")
+    parser.add_argument("recording", help="Path to the binary recording")
+    parser.add_argument("--output", help="Output path (default: recording with the format extension)")
+    parser.add_argument("--format", choices=["csv", "npz", "parquet"], default="csv", help="Output format")
+    parser.add_argument("--columns", nargs="+", help="Only export these columns (tick and stamp_ns are always kept)")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.recording):
+        print(f"Error: Recording {args.recording} not found")
+        return 1
+
+    columns, info = read_recording(args.recording)
+    if args.columns:
+        missing = [name for name in args.columns if name not in columns]
+        if missing:
+            print(f"Error: Unknown columns {missing}")
+            return 1
+        columns = {name: columns[name] for name in ["tick", "stamp_ns"] + args.columns}
+
+    output = args.output or os.path.splitext(args.recording)[0] + "." + args.format
+    if args.format == "csv":
+        with open(output, "w", newline="") as f:
+            writer = csv.writer(f)
+            writer.writerow(columns)
+            writer.writerows(zip(*columns.values()))
+    elif args.format == "npz":
+        try:
+            import numpy as np
+        except ImportError:
+            print("Error: numpy is required for npz output")
+            return 1
+        np.savez(output, **{name: np.asarray(column) for name, column in columns.items()})
+    else:
+        try:
+            import pyarrow as pa
+            import pyarrow.parquet as pq
+        except ImportError:
+            print("Error: pyarrow is required for parquet output")
+            return 1
+        pq.write_table(pa.table(columns), output)
+
+    print(f"{len(columns['tick'])} rows in {info['chunks']} chunks, {info['dropped']} dropped -> {output}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -4,9 +4,14 @@
  */
 
 #include "rl_logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <filesystem>
+#include <limits>
 
-RLLogger::RLLogger()
+RLLogger::RLLogger(size_t chunk_rows)
+    : chunk_rows_(chunk_rows > 0 ? chunk_rows : 1), active_chunks_(0), row_(nullptr), num_rows_(0)
 {
     InitJointNames();
 }
@@ -58,23 +63,152 @@ std::string RLLogger::GetJointName(int joint_index) const
     return "joint_" + std::to_string(joint_index);
 }
 
+int RLLogger::RegisterColumn(const std::string& name)
+{
+    auto it = column_ids_.find(name);
+    if (it != column_ids_.end()) {
+        return it->second;
+    }
+    int id = static_cast<int>(column_names_.size());
+    column_names_.push_back(name);
+    column_ids_[name] = id;
+    return id;
+}
+
+void RLLogger::RegisterJoints(int num_joints)
+{
+    if (static_cast<int>(joint_columns_.size()) < num_joints) {
+        joint_columns_.resize(num_joints, -1);
+    }
+    for (int i = 0; i < num_joints; ++i) {
+        if (joint_columns_[i] >= 0) {
+            continue;
+        }
+        // 记录关节数据，按照deploy_logger的命名格式，同一关节的6列ID连续
+        std::string joint_name = GetJointName(i);
+        joint_columns_[i] = RegisterColumn(joint_name + "_target");
+        RegisterColumn(joint_name + "_actual");
+        RegisterColumn(joint_name + "_dq");
+        RegisterColumn(joint_name + "_kp");
+        RegisterColumn(joint_name + "_kd");
+        RegisterColumn(joint_name + "_tau_est");
+    }
+}
+
+int RLLogger::GetColumn(const std::string& name) const
+{
+    auto it = column_ids_.find(name);
+    return it != column_ids_.end() ? it->second : -1;
+}
+
+RLLogger::Chunk& RLLogger::NextChunk()
+{
+    size_t width = column_names_.size();
+    if (active_chunks_ == chunks_.size()) {
+        chunks_.emplace_back();
+    }
+    Chunk& chunk = chunks_[active_chunks_++];
+    if (!chunk.data || chunk.capacity < chunk_rows_ * width) {
+        chunk.capacity = chunk_rows_ * width;
+        chunk.data.reset(new double[std::max<size_t>(chunk.capacity, 1)]);
+    }
+    chunk.width = width;
+    chunk.rows = 0;
+    return chunk;
+}
+
+void RLLogger::BeginRow()
+{
+    Chunk* chunk = active_chunks_ > 0 ? &chunks_[active_chunks_ - 1] : nullptr;
+    if (!chunk || chunk->width != column_names_.size() || chunk->rows == chunk_rows_) {
+        chunk = &NextChunk();
+    }
+    row_ = chunk->data.get() + chunk->rows * chunk->width;
+    std::fill(row_, row_ + chunk->width, std::numeric_limits<double>::quiet_NaN());
+    ++chunk->rows;
+    ++num_rows_;
+}
+
+void RLLogger::WidenRow()
+{
+    // 当前行开始后又注册了新列：把这一行移到按新列数分配的块中
+    Chunk& old_chunk = chunks_[active_chunks_ - 1];
+    std::vector<double> values(row_, row_ + old_chunk.width);
+    --old_chunk.rows;
+    --num_rows_;
+    if (old_chunk.rows == 0) {
+        --active_chunks_;
+    }
+    BeginRow();
+    std::copy(values.begin(), values.end(), row_);
+}
+
+void RLLogger::Record(int column, double value)
+{
+    if (column < 0 || static_cast<size_t>(column) >= column_names_.size()) {
+        return;
+    }
+    if (!row_) {
+        BeginRow();
+    }
+    if (static_cast<size_t>(column) >= chunks_[active_chunks_ - 1].width) {
+        WidenRow();
+    }
+    else if (!std::isnan(row_[column])) {
+        // 没有显式调用BeginRow时，同一列写第二次即开始新的一行，与原先按列追加的行为一致
+        BeginRow();
+    }
+    row_[column] = value;
+}
+
 void RLLogger::Record(const std::string& key, double value)
 {
-    data_[key].push_back(value);
+    Record(RegisterColumn(key), value);
 }
 
-void RLLogger::RecordJointData(int joint_index, double target_q, double actual_q, 
+void RLLogger::RecordJointData(int joint_index, double target_q, double actual_q,
                               double actual_dq, double kp, double kd, double tau_est)
 {
-    std::string joint_name = GetJointName(joint_index);
-    
-    // 记录关节数据，按照deploy_logger的命名格式
-    Record(joint_name + "_target", target_q);
-    Record(joint_name + "_actual", actual_q);
-    Record(joint_name + "_dq", actual_dq);
-    Record(joint_name + "_kp", kp);
-    Record(joint_name + "_kd", kd);
-    Record(joint_name + "_tau_est", tau_est);
+    if (joint_index < 0) {
+        return;
+    }
+    if (joint_index >= static_cast<int>(joint_columns_.size()) || joint_columns_[joint_index] < 0) {
+        RegisterJoints(joint_index + 1);
+    }
+    int column = joint_columns_[joint_index];
+    if (!row_) {
+        BeginRow();
+    }
+    if (static_cast<size_t>(column + kJointFields) > chunks_[active_chunks_ - 1].width) {
+        WidenRow();
+    }
+    else if (!std::isnan(row_[column])) {
+        BeginRow();
+    }
+    double* cell = row_ + column;
+    cell[0] = target_q;
+    cell[1] = actual_q;
+    cell[2] = actual_dq;
+    cell[3] = kp;
+    cell[4] = kd;
+    cell[5] = tau_est;
+}
+
+void RLLogger::Reserve(size_t rows)
+{
+    size_t needed = active_chunks_ + (rows + chunk_rows_ - 1) / chunk_rows_;
+    size_t capacity = chunk_rows_ * column_names_.size();
+    if (chunks_.size() < needed) {
+        chunks_.resize(needed);
+    }
+    for (size_t i = active_chunks_; i < needed; ++i) {
+        if (!chunks_[i].data || chunks_[i].capacity < capacity) {
+            chunks_[i].capacity = capacity;
+            chunks_[i].data.reset(new double[std::max<size_t>(capacity, 1)]);
+            // 提前触碰内存，避免记录时发生缺页
+            std::fill(chunks_[i].data.get(), chunks_[i].data.get() + capacity, 0.0);
+        }
+    }
 }
 
 std::string RLLogger::GenerateFilename() const
@@ -89,7 +223,7 @@ std::string RLLogger::GenerateFilename() const
 
 void RLLogger::SaveToCSV(const std::string& filename)
 {
-    if (data_.empty()) {
+    if (num_rows_ == 0) {
         std::cout << "⚠️  No data to save" << std::endl;
         return;
     }
@@ -100,18 +234,6 @@ void RLLogger::SaveToCSV(const std::string& filename)
     // 生成文件名（如果未提供）
     std::string output_filename = filename.empty() ? GenerateFilename() : filename;
     
-    // 获取所有键（列名）
-    std::vector<std::string> columns;
-    for (const auto& pair : data_) {
-        columns.push_back(pair.first);
-    }
-    
-    // 获取最大行数
-    size_t max_rows = 0;
-    for (const auto& pair : data_) {
-        max_rows = std::max(max_rows, pair.second.size());
-    }
-    
     // 写入CSV文件
     std::ofstream file(output_filename);
     if (!file.is_open()) {
@@ -120,56 +242,61 @@ void RLLogger::SaveToCSV(const std::string& filename)
     }
     
     // 写入列名
-    for (size_t i = 0; i < columns.size(); ++i) {
-        file << columns[i];
-        if (i < columns.size() - 1) file << ",";
+    const size_t num_columns = column_names_.size();
+    for (size_t i = 0; i < num_columns; ++i) {
+        file << column_names_[i];
+        if (i < num_columns - 1) file << ",";
     }
     file << "\n";
     
-    // 逐行写入数据
-    for (size_t row = 0; row < max_rows; ++row) {
-        for (size_t col = 0; col < columns.size(); ++col) {
-            const std::string& key = columns[col];
-            const auto& values = data_.at(key);
-            
-            if (row < values.size()) {
-                file << values[row];
+    // 逐块逐行写入数据，未写入的单元格和该块之后注册的列留空
+    std::string line;
+    char cell[32];
+    for (size_t c = 0; c < active_chunks_; ++c) {
+        const Chunk& chunk = chunks_[c];
+        for (size_t row = 0; row < chunk.rows; ++row) {
+            const double* values = chunk.data.get() + row * chunk.width;
+            line.clear();
+            for (size_t col = 0; col < num_columns; ++col) {
+                if (col < chunk.width && !std::isnan(values[col])) {
+                    int length = std::snprintf(cell, sizeof(cell), "%g", values[col]);
+                    line.append(cell, length);
+                }
+                line.push_back(col < num_columns - 1 ? ',' : '\n');
             }
-            // 如果该列的数据已经用完，留空
-            
-            if (col < columns.size() - 1) file << ",";
+            file.write(line.data(), line.size());
         }
-        file << "\n";
     }
     
     file.close();
     
     std::cout << "📊 Data saved to: " << output_filename << std::endl;
-    std::cout << "📈 Total records: " << max_rows << std::endl;
-    std::cout << "📋 Columns: " << columns.size() << std::endl;
+    std::cout << "📈 Total records: " << num_rows_ << std::endl;
+    std::cout << "📋 Columns: " << num_columns << std::endl;
 }
 
 void RLLogger::Clear()
 {
-    data_.clear();
+    // 保留已分配的块供后续复用
+    for (size_t c = 0; c < active_chunks_; ++c) {
+        chunks_[c].rows = 0;
+    }
+    active_chunks_ = 0;
+    row_ = nullptr;
+    num_rows_ = 0;
 }
 
 std::string RLLogger::GetSummary() const
 {
-    if (data_.empty()) {
+    if (num_rows_ == 0) {
         return "No data recorded";
     }
     
-    size_t total_records = 0;
-    for (const auto& pair : data_) {
-        total_records = std::max(total_records, pair.second.size());
-    }
-    
-    return "Records: " + std::to_string(total_records) + 
-           ", Columns: " + std::to_string(data_.size());
+    return "Records: " + std::to_string(num_rows_) + 
+           ", Columns: " + std::to_string(column_names_.size());
 }
 
 bool RLLogger::HasData() const
 {
-    return !data_.empty();
+    return num_rows_ > 0;
 }
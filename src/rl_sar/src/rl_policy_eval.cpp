@@ -0,0 +1,530 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "rl_policy_eval.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <tbb/blocked_range.h>
+#include <tbb/global_control.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+/*
+Offline policy evaluation: runs recorded or synthetic trajectories through a policy as one batch.
+
+Usage: rl_policy_eval <robot_name> <config_name> [options] [trajectory.csv ...]
+
+  --envs N        number of synthetic trajectories when no CSV is given (default 64)
+  --steps T       length of the synthetic trajectories in RL steps (default 1000)
+  --seed S        seed of the synthetic trajectories (default 0)
+  --backend B     auto, onnx or torch (default auto)
+  --ang-vel A     body or world, the frame "ang_vel" resolves to (default body, as on the real robot)
+  --threads K     TBB worker threads (default all cores)
+  --output FILE   CSV with the actions and joint targets of every environment and step
+
+Example: rl_policy_eval g1 robomimic/loco --envs 2048 --steps 500 --output loco_eval.csv
+*/
+
+EvalTrajectory LoadTrajectoryCSV(const std::string &path, const ModelParams &params)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Cannot open trajectory " + path);
+    }
+
+    const int num_of_dofs = params.num_of_dofs;
+    EvalStep defaults;
+    defaults.q.assign(params.joint.default_dof_pos.begin(), params.joint.default_dof_pos.begin() + num_of_dofs);
+    defaults.dq.assign(num_of_dofs, 0.0);
+
+    // Every column resolves to the address of its value inside a step, relative to the step
+    std::string line;
+    std::getline(file, line);
+    std::vector<std::function<double *(EvalStep &)>> columns;
+    std::stringstream header(line);
+    std::string name;
+    while (std::getline(header, name, ','))
+    {
+        name.erase(std::remove_if(name.begin(), name.end(), ::isspace), name.end());
+        static const char *fixed[] = {"quat_w", "quat_x", "quat_y", "quat_z", "gyro_x", "gyro_y", "gyro_z", "cmd_x", "cmd_y", "cmd_yaw"};
+        int fixed_index = -1;
+        for (int i = 0; i < 10; ++i)
+        {
+            if (name == fixed[i]) fixed_index = i;
+        }
+        int joint = -1;
+        if (name.compare(0, 2, "q_") == 0 || name.compare(0, 3, "dq_") == 0)
+        {
+            joint = std::atoi(name.c_str() + name.find('_') + 1);
+            if (joint >= num_of_dofs) joint = -1;
+        }
+
+        if (fixed_index >= 0 && fixed_index < 4)
+            columns.push_back([fixed_index](EvalStep &step) { return &step.quaternion[fixed_index]; });
+        else if (fixed_index >= 4 && fixed_index < 7)
+            columns.push_back([fixed_index](EvalStep &step) { return &step.gyroscope[fixed_index - 4]; });
+        else if (fixed_index >= 7)
+            columns.push_back([fixed_index](EvalStep &step) { return &step.commands[fixed_index - 7]; });
+        else if (joint >= 0 && name[0] == 'q')
+            columns.push_back([joint](EvalStep &step) { return &step.q[joint]; });
+        else if (joint >= 0)
+            columns.push_back([joint](EvalStep &step) { return &step.dq[joint]; });
+        else
+            columns.push_back([](EvalStep &) { return static_cast<double *>(nullptr); });
+    }
+
+    EvalTrajectory trajectory;
+    while (std::getline(file, line))
+    {
+        if (line.empty()) continue;
+        EvalStep step = defaults;
+        const char *cursor = line.c_str();
+        for (size_t c = 0; c < columns.size() && *cursor; ++c)
+        {
+            char *end = nullptr;
+            double value = std::strtod(cursor, &end);
+            double *field = columns[c](step);
+            if (field && end != cursor) *field = value;
+            cursor = end;
+            while (*cursor && *cursor != ',') ++cursor;
+            if (*cursor == ',') ++cursor;
+        }
+        trajectory.push_back(step);
+    }
+    if (trajectory.empty())
+    {
+        throw std::runtime_error("Trajectory " + path + " has no steps");
+    }
+    return trajectory;
+}
+
+EvalTrajectory SyntheticTrajectory(const ModelParams &params, int steps, unsigned int seed)
+{
+    const int num_of_dofs = params.num_of_dofs;
+    const double dt = params.dt * params.decimation;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::normal_distribution<double> noise(0.0, 1.0);
+
+    std::vector<double> amplitude(num_of_dofs), frequency(num_of_dofs), phase(num_of_dofs);
+    for (int j = 0; j < num_of_dofs; ++j)
+    {
+        amplitude[j] = 0.1 * std::fabs(uniform(rng));
+        frequency[j] = 0.5 + 1.5 * std::fabs(uniform(rng));
+        phase[j] = M_PI * uniform(rng);
+    }
+    double axis[3] = {uniform(rng), uniform(rng), 0.0};
+    const double norm = std::max(1e-9, std::sqrt(axis[0] * axis[0] + axis[1] * axis[1]));
+    axis[0] /= norm;
+    axis[1] /= norm;
+    const std::array<double, 3> commands{{0.5 * uniform(rng), 0.3 * uniform(rng), 0.5 * uniform(rng)}};
+
+    EvalTrajectory trajectory(steps);
+    for (int t = 0; t < steps; ++t)
+    {
+        EvalStep &step = trajectory[t];
+        const double time = t * dt;
+        const double sway = 0.05 * std::sin(2.0 * M_PI * 0.7 * time);
+        quaternion::FromAxisAngle(axis, sway, step.quaternion.data());
+        for (int k = 0; k < 3; ++k)
+        {
+            step.gyroscope[k] = 0.05 * noise(rng);
+        }
+        step.commands = commands;
+        step.q.resize(num_of_dofs);
+        step.dq.resize(num_of_dofs);
+        for (int j = 0; j < num_of_dofs; ++j)
+        {
+            const double w = 2.0 * M_PI * frequency[j];
+            step.q[j] = params.joint.default_dof_pos[j] + amplitude[j] * std::sin(w * time + phase[j]);
+            step.dq[j] = amplitude[j] * w * std::cos(w * time + phase[j]);
+        }
+    }
+    return trajectory;
+}
+
+void RL_Eval::SetStep(const EvalStep &step)
+{
+    const int num_of_dofs = this->params.num_of_dofs;
+    this->robot_state.imu.quaternion = step.quaternion;
+    this->robot_state.imu.gyroscope = step.gyroscope;
+    std::copy(step.q.begin(), step.q.begin() + num_of_dofs, this->robot_state.motor_state.q.begin());
+    std::copy(step.dq.begin(), step.dq.begin() + num_of_dofs, this->robot_state.motor_state.dq.begin());
+
+    this->episode_length_buf += 1;
+    this->obs.ang_vel = this->robot_state.imu.gyroscope;
+    this->obs.commands = step.commands;
+    this->obs.base_quat = this->robot_state.imu.quaternion;
+    this->obs.dof_pos = this->robot_state.motor_state.q;
+    this->obs.dof_vel = this->robot_state.motor_state.dq;
+}
+
+PolicyEvaluator::PolicyEvaluator(const std::string &robot_name, const std::string &config_name, const std::string &ang_vel_type)
+{
+    torch::autograd::GradMode::set_enabled(false);
+
+    // Same steps as InitRL on the robot: base.yaml, then the policy bundle of the config
+    this->loader.robot_name = robot_name;
+    this->loader.config_name = config_name;
+    this->loader.ang_vel_type = ang_vel_type;
+    this->loader.ReadYamlBase(robot_name);
+    this->robot_path = robot_name + "/" + config_name;
+    this->policy = this->loader.LoadPolicy(this->robot_path);
+    this->loader.policy_registry.Add(this->policy);
+    this->loader.ActivatePolicy(this->policy);
+}
+
+std::shared_ptr<ONNXInferenceEngine> PolicyEvaluator::LoadWorkerEngine() const
+{
+    // The ONNX file LoadPolicy picked, either the configured model or the one next to the .pt
+    std::string model_path = std::string(CMAKE_CURRENT_SOURCE_DIR) + "/policy/" + this->robot_path + "/" + this->policy->params.model_name;
+    size_t pt_pos = model_path.find(".pt");
+    if (model_path.find(".onnx") == std::string::npos && pt_pos != std::string::npos)
+    {
+        model_path.replace(pt_pos, 3, ".onnx");
+    }
+
+    auto engine = std::make_shared<ONNXInferenceEngine>();
+    engine->LoadModel(model_path);
+    RL::InitOnnxOutputs(*engine);
+    return engine;
+}
+
+void PolicyEvaluator::InitEnvs(int num_envs, Backend backend)
+{
+    this->envs.clear();
+    this->envs.reserve(num_envs);
+    for (int i = 0; i < num_envs; ++i)
+    {
+        std::unique_ptr<RL_Eval> env(new RL_Eval());
+        env->robot_name = this->loader.robot_name;
+        env->config_name = this->loader.config_name;
+        env->ActivatePolicy(this->policy);
+        this->envs.push_back(std::move(env));
+    }
+
+    const ModelParams &params = this->policy->params;
+    if (!params.observations_history.empty())
+    {
+        int history_length = *std::max_element(params.observations_history.begin(), params.observations_history.end()) + 1;
+        this->history_obs_buf = ObservationBuffer(num_envs, this->policy->obs_dims, history_length, params.observations_history_priority);
+        this->history_obs_buf.set_obs_ids(params.observations_history);
+    }
+
+    // A session is bound to a batch of one and its outputs are read back after each row, so every worker owns one.
+    // Worker w steps the environments [w * N / W, (w + 1) * N / W) and those read their motion reference from it.
+    this->worker_engines.clear();
+    if (backend == Backend::Onnx)
+    {
+        const int num_workers = std::min(num_envs, tbb::this_task_arena::max_concurrency());
+        this->worker_engines.resize(num_workers);
+        this->worker_engines[0] = this->policy->onnx_engine;
+        tbb::parallel_for(1, num_workers, [this](int w) { this->worker_engines[w] = this->LoadWorkerEngine(); });
+        for (int w = 0; w < num_workers; ++w)
+        {
+            for (int i = w * num_envs / num_workers; i < (w + 1) * num_envs / num_workers; ++i)
+            {
+                this->envs[i]->onnx_engine = this->worker_engines[w];
+            }
+        }
+    }
+}
+
+void PolicyEvaluator::WriteHeader(std::FILE *file, int num_actions, int num_of_dofs)
+{
+    std::fprintf(file, "env,step");
+    for (int j = 0; j < num_actions; ++j) std::fprintf(file, ",action_%d", j);
+    for (int j = 0; j < num_of_dofs; ++j) std::fprintf(file, ",dof_pos_%d", j);
+    std::fprintf(file, "\n");
+}
+
+void PolicyEvaluator::Run(const std::vector<EvalTrajectory> &trajectories, Backend backend, const std::string &output_path)
+{
+    const ModelParams &params = this->policy->params;
+    const int num_envs = static_cast<int>(trajectories.size());
+    if (num_envs == 0)
+    {
+        throw std::invalid_argument("No trajectories to evaluate");
+    }
+    for (const EvalTrajectory &trajectory : trajectories)
+    {
+        for (const EvalStep &step : trajectory)
+        {
+            if (static_cast<int>(step.q.size()) < params.num_of_dofs || static_cast<int>(step.dq.size()) < params.num_of_dofs)
+            {
+                throw std::invalid_argument("Trajectory step has fewer than num_of_dofs joints");
+            }
+        }
+    }
+
+    if (backend == Backend::Auto)
+    {
+        backend = this->policy->onnx_engine->IsModelLoaded() ? Backend::Onnx : Backend::Torch;
+    }
+    if (backend == Backend::Onnx && !this->policy->onnx_engine->IsModelLoaded())
+    {
+        throw std::runtime_error("No ONNX model loaded for " + this->robot_path);
+    }
+    if (backend == Backend::Torch && !this->policy->pytorch_model_loaded)
+    {
+        throw std::runtime_error("No TorchScript model loaded for " + this->robot_path);
+    }
+
+    auto init_start = std::chrono::steady_clock::now();
+    this->InitEnvs(num_envs, backend);
+    const double init_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - init_start).count();
+
+    size_t num_steps = 0;
+    size_t env_steps = 0;
+    for (const EvalTrajectory &trajectory : trajectories)
+    {
+        num_steps = std::max(num_steps, trajectory.size());
+        env_steps += trajectory.size();
+    }
+    if (num_steps == 0)
+    {
+        throw std::invalid_argument("No trajectory steps to evaluate");
+    }
+
+    const bool history = !params.observations_history.empty();
+    const int num_obs = static_cast<int>(this->loader.obs_data.size());
+    const int input_size = history ? this->history_obs_buf.obs_vec_size() : num_obs;
+    const int num_of_dofs = params.num_of_dofs;
+    const bool clip = params.clip_actions_upper.numel() != 0 && params.clip_actions_lower.numel() != 0;
+
+    torch::Tensor batch_obs = torch::zeros({num_envs, num_obs}, torch::kFloat32);
+    torch::Tensor batch_input = history ? torch::zeros({num_envs, input_size}, torch::kFloat32) : batch_obs;
+    torch::Tensor actions;
+    int num_actions = num_of_dofs;
+    std::vector<double> dof_pos(static_cast<size_t>(num_envs) * num_of_dofs);
+
+    std::FILE *output = nullptr;
+    if (!output_path.empty())
+    {
+        output = std::fopen(output_path.c_str(), "w");
+        if (!output)
+        {
+            throw std::runtime_error("Cannot open " + output_path);
+        }
+    }
+
+    std::cout << LOGGER::INFO << "Evaluating " << this->robot_path << " on " << num_envs << " environments, " << num_steps
+              << " steps, backend " << (backend == Backend::Onnx ? "onnx" : "torch") << ", "
+              << (backend == Backend::Onnx ? this->worker_engines.size() : 1) << " sessions" << std::endl;
+
+    double observation_ms = 0.0, inference_ms = 0.0, output_ms = 0.0;
+    auto run_start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < num_steps; ++t)
+    {
+        // Environments whose trajectory ended hold their last step, their rows are not written
+        auto stage_start = std::chrono::steady_clock::now();
+        float *obs_rows = batch_obs.data_ptr<float>();
+        tbb::parallel_for(tbb::blocked_range<int>(0, num_envs), [&](const tbb::blocked_range<int> &range)
+        {
+            for (int i = range.begin(); i < range.end(); ++i)
+            {
+                const EvalTrajectory &trajectory = trajectories[i];
+                RL_Eval &env = *this->envs[i];
+                env.SetStep(trajectory[std::min(t, trajectory.size() - 1)]);
+                env.ComputeObservation();
+                std::memcpy(obs_rows + static_cast<size_t>(i) * num_obs, env.obs_data.data(), num_obs * sizeof(float));
+            }
+        });
+        if (history)
+        {
+            this->history_obs_buf.insert(batch_obs);
+            this->history_obs_buf.gather_obs_vec(batch_input.data_ptr<float>());
+        }
+        auto inference_start = std::chrono::steady_clock::now();
+        observation_ms += std::chrono::duration<double, std::milli>(inference_start - stage_start).count();
+
+        if (backend == Backend::Torch)
+        {
+            actions = this->policy->model.forward({batch_input}).toTensor().to(torch::kFloat32).contiguous();
+            num_actions = static_cast<int>(actions.size(1));
+        }
+        else
+        {
+            if (!actions.defined())
+            {
+                actions = torch::zeros({num_envs, num_actions}, torch::kFloat32);
+            }
+            const float *input_rows = batch_input.data_ptr<float>();
+            float *action_rows = actions.data_ptr<float>();
+            const int num_workers = static_cast<int>(this->worker_engines.size());
+            tbb::parallel_for(0, num_workers, [&](int w)
+            {
+                ONNXInferenceEngine &engine = *this->worker_engines[w];
+                for (int i = w * num_envs / num_workers; i < (w + 1) * num_envs / num_workers; ++i)
+                {
+                    engine.Run(input_rows + static_cast<size_t>(i) * input_size, input_size, static_cast<float>(this->envs[i]->episode_length_buf));
+                    TensorView<float> view = engine.GetOutputView<float>(0);
+                    std::memcpy(action_rows + static_cast<size_t>(i) * num_actions, view.data, std::min<size_t>(view.size, num_actions) * sizeof(float));
+                    if (this->policy->onnx_motion_outputs)
+                    {
+                        this->envs[i]->UpdateMotionReference();
+                    }
+                }
+            });
+        }
+        if (clip)
+        {
+            actions = torch::clamp(actions, params.clip_actions_lower, params.clip_actions_upper).to(torch::kFloat32).contiguous();
+        }
+        auto output_start = std::chrono::steady_clock::now();
+        inference_ms += std::chrono::duration<double, std::milli>(output_start - inference_start).count();
+
+        tbb::parallel_for(tbb::blocked_range<int>(0, num_envs), [&](const tbb::blocked_range<int> &range)
+        {
+            for (int i = range.begin(); i < range.end(); ++i)
+            {
+                RL_Eval &env = *this->envs[i];
+                env.obs.actions.copy_(actions.narrow(0, i, 1));
+                env.ComputeOutput(env.obs.actions, env.output_dof_pos, env.output_dof_vel, env.output_dof_tau);
+                torch::Tensor target = env.output_dof_pos.to(torch::kFloat64).contiguous();
+                std::copy(target.data_ptr<double>(), target.data_ptr<double>() + num_of_dofs, dof_pos.begin() + static_cast<size_t>(i) * num_of_dofs);
+            }
+        });
+        output_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - output_start).count();
+
+        if (output)
+        {
+            if (t == 0)
+            {
+                WriteHeader(output, num_actions, num_of_dofs);
+            }
+            const float *action_rows = actions.data_ptr<float>();
+            for (int i = 0; i < num_envs; ++i)
+            {
+                if (t >= trajectories[i].size()) continue;
+                std::fprintf(output, "%d,%zu", i, t);
+                for (int j = 0; j < num_actions; ++j) std::fprintf(output, ",%.6g", action_rows[static_cast<size_t>(i) * num_actions + j]);
+                for (int j = 0; j < num_of_dofs; ++j) std::fprintf(output, ",%.6g", dof_pos[static_cast<size_t>(i) * num_of_dofs + j]);
+                std::fprintf(output, "\n");
+            }
+        }
+    }
+    const double run_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - run_start).count();
+
+    if (output)
+    {
+        std::fclose(output);
+        std::cout << LOGGER::INFO << "Wrote " << env_steps << " rows to " << output_path << std::endl;
+    }
+    const double realtime_ms = env_steps * params.dt * params.decimation * 1000.0;
+    std::cout << LOGGER::INFO << "Setup " << init_ms << " ms, run " << run_ms << " ms for " << env_steps << " env steps ("
+              << env_steps / std::max(run_ms, 1e-9) * 1000.0 << " steps/s, " << realtime_ms / std::max(run_ms, 1e-9) << "x real time)" << std::endl;
+    std::cout << LOGGER::INFO << "Per step: observation " << observation_ms / num_steps << " ms, inference " << inference_ms / num_steps
+              << " ms, output " << output_ms / num_steps << " ms" << std::endl;
+}
+
+static void PrintUsage()
+{
+    std::cout << "Usage: rl_policy_eval <robot_name> <config_name> [--envs N] [--steps T] [--seed S] [--backend auto|onnx|torch]\n"
+              << "                      [--ang-vel body|world] [--threads K] [--output FILE] [trajectory.csv ...]" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::string robot_name = argv[1];
+    std::string config_name = argv[2];
+    int num_envs = 64;
+    int num_steps = 1000;
+    unsigned int seed = 0;
+    int num_threads = 0;
+    std::string backend_name = "auto";
+    std::string ang_vel = "body";
+    std::string output_path;
+    std::vector<std::string> trajectory_paths;
+
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string
+        {
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "--envs") num_envs = std::stoi(value());
+        else if (arg == "--steps") num_steps = std::stoi(value());
+        else if (arg == "--seed") seed = static_cast<unsigned int>(std::stoul(value()));
+        else if (arg == "--backend") backend_name = value();
+        else if (arg == "--ang-vel") ang_vel = value();
+        else if (arg == "--threads") num_threads = std::stoi(value());
+        else if (arg == "--output") output_path = value();
+        else if (arg == "-h" || arg == "--help")
+        {
+            PrintUsage();
+            return 0;
+        }
+        else trajectory_paths.push_back(arg);
+    }
+    if (num_steps <= 0 || num_envs <= 0)
+    {
+        std::cout << LOGGER::ERROR << "--steps and --envs must be positive, got " << num_steps << " and " << num_envs << std::endl;
+        return 1;
+    }
+
+    PolicyEvaluator::Backend backend;
+    if (backend_name == "auto") backend = PolicyEvaluator::Backend::Auto;
+    else if (backend_name == "onnx") backend = PolicyEvaluator::Backend::Onnx;
+    else if (backend_name == "torch") backend = PolicyEvaluator::Backend::Torch;
+    else
+    {
+        std::cout << LOGGER::ERROR << "Unknown backend '" << backend_name << "'" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<tbb::global_control> thread_limit;
+    if (num_threads > 0)
+    {
+        thread_limit.reset(new tbb::global_control(tbb::global_control::max_allowed_parallelism, num_threads));
+    }
+
+    try
+    {
+        PolicyEvaluator evaluator(robot_name, config_name, ang_vel == "world" ? "ang_vel_world" : "ang_vel_body");
+
+        std::vector<EvalTrajectory> trajectories;
+        if (trajectory_paths.empty())
+        {
+            trajectories.resize(num_envs);
+            tbb::parallel_for(0, num_envs, [&](int i) { trajectories[i] = SyntheticTrajectory(evaluator.Params(), num_steps, seed + i); });
+        }
+        else
+        {
+            trajectories.resize(trajectory_paths.size());
+            tbb::parallel_for(size_t(0), trajectory_paths.size(), [&](size_t i) { trajectories[i] = LoadTrajectoryCSV(trajectory_paths[i], evaluator.Params()); });
+        }
+
+        evaluator.Run(trajectories, backend, output_path);
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << LOGGER::ERROR << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -13,7 +13,7 @@
 // 全局指针用于信号处理
 // RL_Real* g_rl_real_instance = nullptr;
 
-RL_Real::RL_Real()
+RL_Real::RL_Real(bool connect, const std::string &lowstate_record_path)
 #if defined(USE_ROS2) && defined(USE_ROS)
     : rclcpp::Node("rl_real_node")
 #endif
@@ -49,7 +49,12 @@ RL_Real::RL_Real()
 
     // init torch
     torch::autograd::GradMode::set_enabled(false);
-    torch::set_num_threads(4);
+    // TorchScript runs inline on loop_rl. Intra-op threads would be started from loop_rl and inherit its fifo schedule
+    // and CPUs, ONNX Runtime's start with the session under ThreadScheduleReset.
+    torch::set_num_threads(1);
+
+    // load every policy the FSM can switch to, state entry then only activates it
+    this->PreloadPolicies(FSMManager::GetInstance().GetPolicies(this->robot_name));
 
     // init robot
     this->mode_pr = Mode::PR;
@@ -58,6 +63,14 @@ RL_Real::RL_Real()
     this->InitLowCmd();
     this->InitOutputs();
     this->InitControl();
+    if (!connect)
+    {
+        return;
+    }
+    if (!lowstate_record_path.empty())
+    {
+        this->lowstate_recorder.Open(lowstate_record_path, LowStateColumns());
+    }
     // init MotionSwitcherClient
     this->msc.SetTimeout(5.0f);
     this->msc.Init();
@@ -85,9 +98,18 @@ RL_Real::RL_Real()
     this->loop_keyboard = std::make_shared<LoopFunc>("loop_keyboard", 0.05, std::bind(&RL_Real::KeyboardInterface, this));
     this->loop_control = std::make_shared<LoopFunc>("loop_control", this->params.dt, std::bind(&RL_Real::RobotControl, this));
     this->loop_rl = std::make_shared<LoopFunc>("loop_rl", this->params.dt * this->params.decimation, std::bind(&RL_Real::RunModel, this));
+    this->loop_control->setTiming(LoopFunc::Timing::Absolute, LoopFunc::OverrunPolicy::Skip);
+    this->loop_rl->setTiming(LoopFunc::Timing::Absolute, LoopFunc::OverrunPolicy::Skip);
+    this->loop_keyboard->setSchedule(this->GetLoopSchedule("loop_keyboard"));
+    this->loop_control->setSchedule(this->GetLoopSchedule("loop_control"));
+    this->loop_rl->setSchedule(this->GetLoopSchedule("loop_rl"));
+    // the stats are printed from a loop of their own, console output can block the real-time loops
+    this->loop_stats = std::make_shared<LoopFunc>("loop_stats", 30.0, std::bind(&RL_Real::PrintLoopStats, this));
+    this->loop_stats->setSchedule(this->GetLoopSchedule("loop_stats"));
     this->loop_keyboard->start();
     this->loop_control->start();
     this->loop_rl->start();
+    this->loop_stats->start();
 
 #ifdef PLOT
     this->plot_t = std::vector<int>(this->plot_size, 0);
@@ -98,31 +120,47 @@ RL_Real::RL_Real()
     this->loop_plot = std::make_shared<LoopFunc>("loop_plot", 0.002, std::bind(&RL_Real::Plot, this));
     this->loop_plot->start();
 #endif
-#ifdef CSV_LOGGER
-    this->CSVInit(this->robot_name);
+#ifdef TELEMETRY
+    this->TelemetryInit(this->robot_name);
 #endif
 }
 
 RL_Real::~RL_Real()
 {
-    this->loop_keyboard->shutdown();
-    this->loop_control->shutdown();
-    this->loop_rl->shutdown();
+    if (this->loop_control)
+    {
+        this->loop_stats->shutdown();
+        this->loop_keyboard->shutdown();
+        this->loop_control->shutdown();
+        this->loop_rl->shutdown();
+        this->PrintLoopStats();
 #ifdef PLOT
-    this->loop_plot->shutdown();
+        this->loop_plot->shutdown();
 #endif
+    }
+    this->lowstate_recorder.Close();
     std::cout << LOGGER::INFO << "RL_Real exit" << std::endl;
 }
 
 void RL_Real::GetState(RobotState<double> *state)
 {
-    if (this->mode_machine != this->unitree_low_state.mode_machine())
+    // Take the newest messages if the DDS threads published any, otherwise keep reading the previous ones
+    this->unitree_low_state_buffer.Update();
+    this->unitree_imu_torso_buffer.Update();
+    const LowState_ &unitree_low_state = this->unitree_low_state_buffer.Read().value;
+    const IMUState_ &unitree_imu_torso = this->unitree_imu_torso_buffer.Read().value;
+    if (this->lowstate_recorder.IsOpen())
+    {
+        this->RecordLowState(unitree_low_state, unitree_imu_torso);
+    }
+
+    if (this->mode_machine != unitree_low_state.mode_machine())
     {
         if (this->mode_machine == 0)
         {
-            std::cout << "G1 type: " << unsigned(this->unitree_low_state.mode_machine()) << std::endl;
+            std::cout << "G1 type: " << unsigned(unitree_low_state.mode_machine()) << std::endl;
         }
-        this->mode_machine = this->unitree_low_state.mode_machine();
+        this->mode_machine = unitree_low_state.mode_machine();
     }
 
     memcpy(this->remote_data_rx.buff, &unitree_low_state.wireless_remote()[0], 40);
@@ -166,24 +204,24 @@ void RL_Real::GetState(RobotState<double> *state)
     this->control.y = -this->gamepad.lx;
     this->control.yaw = -this->gamepad.rx;
 
-    state->imu.quaternion[0] = this->unitree_low_state.imu_state().quaternion()[0]; // w
-    state->imu.quaternion[1] = this->unitree_low_state.imu_state().quaternion()[1]; // x
-    state->imu.quaternion[2] = this->unitree_low_state.imu_state().quaternion()[2]; // y
-    state->imu.quaternion[3] = this->unitree_low_state.imu_state().quaternion()[3]; // z
-    state->torso_imu.quaternion[0] = this->unitree_imu_torso.quaternion()[0]; // w
-    state->torso_imu.quaternion[1] = this->unitree_imu_torso.quaternion()[1]; // x
-    state->torso_imu.quaternion[2] = this->unitree_imu_torso.quaternion()[2]; // y
-    state->torso_imu.quaternion[3] = this->unitree_imu_torso.quaternion()[3]; // z
+    state->imu.quaternion[0] = unitree_low_state.imu_state().quaternion()[0]; // w
+    state->imu.quaternion[1] = unitree_low_state.imu_state().quaternion()[1]; // x
+    state->imu.quaternion[2] = unitree_low_state.imu_state().quaternion()[2]; // y
+    state->imu.quaternion[3] = unitree_low_state.imu_state().quaternion()[3]; // z
+    state->torso_imu.quaternion[0] = unitree_imu_torso.quaternion()[0]; // w
+    state->torso_imu.quaternion[1] = unitree_imu_torso.quaternion()[1]; // x
+    state->torso_imu.quaternion[2] = unitree_imu_torso.quaternion()[2]; // y
+    state->torso_imu.quaternion[3] = unitree_imu_torso.quaternion()[3]; // z
 
     for (int i = 0; i < 3; ++i)
     {
-        state->imu.gyroscope[i] = this->unitree_low_state.imu_state().gyroscope()[i];
+        state->imu.gyroscope[i] = unitree_low_state.imu_state().gyroscope()[i];
     }
     for (int i = 0; i < this->params.num_of_dofs; ++i)
     {
-        state->motor_state.q[i] = this->unitree_low_state.motor_state()[this->params.joint_mapping[i]].q();
-        state->motor_state.dq[i] = this->unitree_low_state.motor_state()[this->params.joint_mapping[i]].dq();
-        state->motor_state.tau_est[i] = this->unitree_low_state.motor_state()[this->params.joint_mapping[i]].tau_est();
+        state->motor_state.q[i] = unitree_low_state.motor_state()[this->params.joint_mapping[i]].q();
+        state->motor_state.dq[i] = unitree_low_state.motor_state()[this->params.joint_mapping[i]].dq();
+        state->motor_state.tau_est[i] = unitree_low_state.motor_state()[this->params.joint_mapping[i]].tau_est();
     }
 }
 
@@ -203,10 +241,22 @@ void RL_Real::SetCommand(const RobotCommand<double> *command)
     }
 
     this->unitree_low_command.crc() = Crc32Core((uint32_t *)&unitree_low_command, (sizeof(LowCmd_) >> 2) - 1);
-    lowcmd_publisher->Write(unitree_low_command);
+    // not created in replay, where the command stops here
+    if (this->lowcmd_publisher)
+    {
+        this->lowcmd_publisher->Write(unitree_low_command);
+    }
 }
 
 void RL_Real::RobotControl()
+{
+    this->UpdateControlInput();
+    this->GetState(&this->robot_state);
+    this->StateController(&this->robot_state, &this->robot_command);
+    this->SetCommand(&this->robot_command);
+}
+
+void RL_Real::UpdateControlInput()
 {
     this->motiontime++;
 
@@ -253,32 +303,29 @@ void RL_Real::RobotControl()
         std::cout << std::endl << LOGGER::INFO << "Navigation mode: " << (this->control.navigation_mode ? "ON" : "OFF") << std::endl;
         this->control.current_keyboard = this->control.last_keyboard;
     }
-
-    this->GetState(&this->robot_state);
-    this->StateController(&this->robot_state, &this->robot_command);
-    this->SetCommand(&this->robot_command);
 }
 
 void RL_Real::RunModel()
 {
+    this->ApplyPendingPolicyState();
     if (this->rl_init_done)
     {
         this->episode_length_buf += 1;
-        this->obs.ang_vel = torch::tensor(this->robot_state.imu.gyroscope).unsqueeze(0);
+        // Plain copies of this tick's state, Forward builds the observation from them without allocating
+        this->obs.ang_vel = this->robot_state.imu.gyroscope;
         if (this->control.navigation_mode)
         {
 #if !defined(USE_CMAKE) && defined(USE_ROS)
-            this->obs.commands = torch::tensor({{this->cmd_vel.linear.x, this->cmd_vel.linear.y, this->cmd_vel.angular.z}});
+            this->obs.commands = {{this->cmd_vel.linear.x, this->cmd_vel.linear.y, this->cmd_vel.angular.z}};
 #endif
         }
         else
         {
-            this->obs.commands = torch::tensor({{this->control.x, this->control.y, this->control.yaw}});
+            this->obs.commands = {{this->control.x, this->control.y, this->control.yaw}};
         }
-        this->obs.base_quat = torch::tensor(this->robot_state.imu.quaternion).unsqueeze(0);
-        this->obs.torso_quat = torch::tensor(this->robot_state.torso_imu.quaternion).unsqueeze(0);
-        this->obs.dof_pos = torch::tensor(this->robot_state.motor_state.q).narrow(0, 0, this->params.num_of_dofs).unsqueeze(0);
-        this->obs.dof_vel = torch::tensor(this->robot_state.motor_state.dq).narrow(0, 0, this->params.num_of_dofs).unsqueeze(0);
+        this->obs.base_quat = this->robot_state.imu.quaternion;
+        this->obs.dof_pos = this->robot_state.motor_state.q;
+        this->obs.dof_vel = this->robot_state.motor_state.dq;
 
         this->obs.actions = this->Forward();
         // std::cout << "actions:";
@@ -291,95 +338,21 @@ void RL_Real::RunModel()
 
         this->ComputeOutput(this->obs.actions, this->output_dof_pos, this->output_dof_vel, this->output_dof_tau);
 
-        if (this->output_dof_pos.defined() && this->output_dof_pos.numel() > 0)
-        {
-            output_dof_pos_queue.push(this->output_dof_pos);
-        }
-        if (this->output_dof_vel.defined() && this->output_dof_vel.numel() > 0)
-        {
-            output_dof_vel_queue.push(this->output_dof_vel);
-        }
-        if (this->output_dof_tau.defined() && this->output_dof_tau.numel() > 0)
-        {
-            output_dof_tau_queue.push(this->output_dof_tau);
-        }
+        this->PublishOutput();
 
         // this->TorqueProtect(this->output_dof_tau);
         // this->AttitudeProtect(this->robot_state.imu.quaternion, 75.0f, 75.0f);
 
-#ifdef CSV_LOGGER
-        torch::Tensor tau_est = torch::tensor(this->robot_state.motor_state.tau_est).unsqueeze(0);
-        this->CSVLogger(this->output_dof_tau, tau_est, this->obs.dof_pos, this->output_dof_pos, this->obs.dof_vel);
+#ifdef TELEMETRY
+        this->TelemetryRecord();
 #endif
     }
 }
 
-torch::Tensor RL_Real::Forward()
+void RL_Real::PrintLoopStats()
 {
-    torch::autograd::GradMode::set_enabled(false);
-
-    // Try ONNX inference first if model is loaded
-    if (this->onnx_engine.IsModelLoaded()) {
-        // try {
-            std::vector<float> clamped_obs_float = this->ComputeObservationFloat();
-            float motion_step = static_cast<float>(this->episode_length_buf);
-
-            std::vector<Ort::Value> policy_output;
-            policy_output = this->onnx_engine.Forward(clamped_obs_float, motion_step);
-            
-            auto actions = this->onnx_engine.ExtractTensorData(policy_output[0]);
-            auto body_quat_w = this->onnx_engine.ExtractTensorData(policy_output[4]);
-
-            std::vector<float> motion_anchor_quat_w = {body_quat_w[28], 
-                                                        body_quat_w[29],
-                                                        body_quat_w[30],
-                                                        body_quat_w[31]};
-
-            this->ref_joint_pos = this->VectorToTensor(this->onnx_engine.ExtractTensorData(policy_output[1]), {1, 29});
-            this->ref_joint_vel = this->VectorToTensor(this->onnx_engine.ExtractTensorData(policy_output[2]), {1, 29});
-            this->ref_body_quat_w = this->VectorToTensor(motion_anchor_quat_w, {1, 4});
-
-            // Convert back to tensor
-            torch::Tensor actions_tensor = this->VectorToTensor(actions, {1, 29});
-
-            // Apply clipping
-            if (this->params.clip_actions_upper.numel() != 0 && this->params.clip_actions_lower.numel() != 0) {
-                return torch::clamp(actions_tensor, this->params.clip_actions_lower, this->params.clip_actions_upper);
-            } else {
-                return actions_tensor;
-            }
-        // } catch (const std::exception& e) {
-        //     std::cerr << "[Forward] ONNX inference failed: " << e.what() << ", falling back to PyTorch" << std::endl;
-        // }
-    }
-
-    // Fallback to PyTorch inference only if PyTorch model is loaded
-    if (!this->pytorch_model_loaded) {
-        throw std::runtime_error("No valid inference model available (neither ONNX nor PyTorch model loaded)");
-    }
-
-    torch::Tensor clamped_obs = this->ComputeObservation();
-
-    torch::Tensor actions;
-    if (!this->params.observations_history.empty())
-    {
-        this->history_obs_buf.insert(clamped_obs);
-        this->history_obs = this->history_obs_buf.get_obs_vec(this->params.observations_history);
-        actions = this->model.forward({this->history_obs}).toTensor();
-    }
-    else
-    {
-        actions = this->model.forward({clamped_obs}).toTensor();
-    }
-
-    if (this->params.clip_actions_upper.numel() != 0 && this->params.clip_actions_lower.numel() != 0)
-    {
-        return torch::clamp(actions, this->params.clip_actions_lower, this->params.clip_actions_upper);
-    }
-    else
-    {
-        return actions;
-    }
+    this->loop_control->logStats();
+    this->loop_rl->logStats();
 }
 
 void RL_Real::Plot()
@@ -392,8 +365,9 @@ void RL_Real::Plot()
     {
         this->plot_real_joint_pos[i].erase(this->plot_real_joint_pos[i].begin());
         this->plot_target_joint_pos[i].erase(this->plot_target_joint_pos[i].begin());
-        this->plot_real_joint_pos[i].push_back(this->unitree_low_state.motor_state()[i].q());
-        this->plot_target_joint_pos[i].push_back(this->unitree_low_command.motor_cmd()[i].q());
+        // joint order, the DDS state buffer has a single reader, which is GetState
+        this->plot_real_joint_pos[i].push_back(this->robot_state.motor_state.q[i]);
+        this->plot_target_joint_pos[i].push_back(this->robot_command.motor_command.q[i]);
         plt::subplot(this->params.num_of_dofs, 1, i + 1);
         plt::named_plot("_real_joint_pos", this->plot_t, this->plot_real_joint_pos[i], "r");
         plt::named_plot("_target_joint_pos", this->plot_t, this->plot_target_joint_pos[i], "b");
@@ -405,36 +379,8 @@ void RL_Real::Plot()
 
 uint32_t RL_Real::Crc32Core(uint32_t *ptr, uint32_t len)
 {
-    unsigned int xbit = 0;
-    unsigned int data = 0;
-    unsigned int CRC32 = 0xFFFFFFFF;
-    const unsigned int dwPolynomial = 0x04c11db7;
-
-    for (unsigned int i = 0; i < len; ++i)
-    {
-        xbit = 1 << 31;
-        data = ptr[i];
-        for (unsigned int bits = 0; bits < 32; bits++)
-        {
-            if (CRC32 & 0x80000000)
-            {
-                CRC32 <<= 1;
-                CRC32 ^= dwPolynomial;
-            }
-            else
-            {
-                CRC32 <<= 1;
-            }
-
-            if (data & xbit)
-            {
-                CRC32 ^= dwPolynomial;
-            }
-            xbit >>= 1;
-        }
-    }
-
-    return CRC32;
+    // Same checksum as the bit-by-bit routine this replaced, see test/test_crc32.cpp
+    return crc32::Compute(ptr, len);
 }
 
 void RL_Real::InitLowCmd()
@@ -452,12 +398,226 @@ void RL_Real::InitLowCmd()
 
 void RL_Real::LowStateHandler(const void *message)
 {
-    this->unitree_low_state = *(const LowState_ *)message;
+    this->unitree_low_state_buffer.Write(*(const LowState_ *)message);
 }
 
 void RL_Real::ImuTorsoHandler(const void *message)
 {
-    this->unitree_imu_torso = *(const IMUState_ *)message;
+    this->unitree_imu_torso_buffer.Write(*(const IMUState_ *)message);
+}
+
+std::vector<std::string> RL_Real::LowStateColumns()
+{
+    std::vector<std::string> columns = {
+        "mode_machine",
+        "remote_btn", "remote_lx", "remote_rx", "remote_ry", "remote_l2", "remote_ly",
+        "imu_quat_w", "imu_quat_x", "imu_quat_y", "imu_quat_z",
+        "imu_gyro_x", "imu_gyro_y", "imu_gyro_z",
+        "imu_acc_x", "imu_acc_y", "imu_acc_z",
+        "torso_quat_w", "torso_quat_x", "torso_quat_y", "torso_quat_z",
+        "torso_gyro_x", "torso_gyro_y", "torso_gyro_z",
+        "torso_acc_x", "torso_acc_y", "torso_acc_z"};
+    // every motor of the message, joint_mapping is applied by GetState on replay
+    const size_t num_motors = LowState_().motor_state().size();
+    for (size_t i = 0; i < num_motors; ++i)
+    {
+        columns.push_back("motor_q_" + std::to_string(i));
+        columns.push_back("motor_dq_" + std::to_string(i));
+        columns.push_back("motor_tau_est_" + std::to_string(i));
+    }
+    return columns;
+}
+
+void RL_Real::RecordLowState(const LowState_ &low_state, const IMUState_ &imu_torso)
+{
+    double *row = this->lowstate_recorder.Begin(this->motiontime);
+    if (!row)
+    {
+        return;
+    }
+
+    REMOTE_DATA_RX remote;
+    memcpy(remote.buff, &low_state.wireless_remote()[0], 40);
+    *row++ = low_state.mode_machine();
+    *row++ = remote.RF_RX.btn.value;
+    *row++ = remote.RF_RX.lx;
+    *row++ = remote.RF_RX.rx;
+    *row++ = remote.RF_RX.ry;
+    *row++ = remote.RF_RX.L2;
+    *row++ = remote.RF_RX.ly;
+    for (int i = 0; i < 4; ++i) *row++ = low_state.imu_state().quaternion()[i];
+    for (int i = 0; i < 3; ++i) *row++ = low_state.imu_state().gyroscope()[i];
+    for (int i = 0; i < 3; ++i) *row++ = low_state.imu_state().accelerometer()[i];
+    for (int i = 0; i < 4; ++i) *row++ = imu_torso.quaternion()[i];
+    for (int i = 0; i < 3; ++i) *row++ = imu_torso.gyroscope()[i];
+    for (int i = 0; i < 3; ++i) *row++ = imu_torso.accelerometer()[i];
+    for (const auto &motor : low_state.motor_state())
+    {
+        *row++ = motor.q();
+        *row++ = motor.dq();
+        *row++ = motor.tau_est();
+    }
+    this->lowstate_recorder.Commit();
+}
+
+void RL_Real::LowStateFromRow(const double *row, LowState_ &low_state, IMUState_ &imu_torso)
+{
+    REMOTE_DATA_RX remote;
+    memset(remote.buff, 0, sizeof(remote.buff));
+    low_state.mode_machine() = static_cast<uint8_t>(*row++);
+    remote.RF_RX.btn.value = static_cast<uint16_t>(*row++);
+    remote.RF_RX.lx = static_cast<float>(*row++);
+    remote.RF_RX.rx = static_cast<float>(*row++);
+    remote.RF_RX.ry = static_cast<float>(*row++);
+    remote.RF_RX.L2 = static_cast<float>(*row++);
+    remote.RF_RX.ly = static_cast<float>(*row++);
+    memcpy(&low_state.wireless_remote()[0], remote.buff, 40);
+    for (int i = 0; i < 4; ++i) low_state.imu_state().quaternion()[i] = static_cast<float>(*row++);
+    for (int i = 0; i < 3; ++i) low_state.imu_state().gyroscope()[i] = static_cast<float>(*row++);
+    for (int i = 0; i < 3; ++i) low_state.imu_state().accelerometer()[i] = static_cast<float>(*row++);
+    for (int i = 0; i < 4; ++i) imu_torso.quaternion()[i] = static_cast<float>(*row++);
+    for (int i = 0; i < 3; ++i) imu_torso.gyroscope()[i] = static_cast<float>(*row++);
+    for (int i = 0; i < 3; ++i) imu_torso.accelerometer()[i] = static_cast<float>(*row++);
+    for (auto &motor : low_state.motor_state())
+    {
+        motor.q() = static_cast<float>(*row++);
+        motor.dq() = static_cast<float>(*row++);
+        motor.tau_est() = static_cast<float>(*row++);
+    }
+}
+
+int RL_Real::Replay(const std::string &recording_path, bool realtime, const std::string &output_path)
+{
+    TelemetryReader reader;
+    if (!reader.Open(recording_path))
+    {
+        return -1;
+    }
+
+    // Recordings are matched by column name, so files from a build with fewer motors still replay
+    const std::vector<std::string> columns = LowStateColumns();
+    std::vector<int> column_index(columns.size());
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        column_index[i] = reader.FindColumn(columns[i]);
+        if (column_index[i] < 0)
+        {
+            std::cout << LOGGER::WARNING << "Recording has no column " << columns[i] << ", replaying it as 0" << std::endl;
+        }
+    }
+
+    std::FILE *output = nullptr;
+    if (!output_path.empty())
+    {
+        output = std::fopen(output_path.c_str(), "w");
+        if (!output)
+        {
+            std::cout << LOGGER::ERROR << "Failed to open " << output_path << std::endl;
+            return -1;
+        }
+        std::fprintf(output, "tick,stamp_ns");
+        const char *fields[] = {"q", "dq", "kp", "kd", "tau"};
+        for (const char *field : fields)
+        {
+            for (int i = 0; i < this->params.num_of_dofs; ++i)
+            {
+                std::fprintf(output, ",cmd_%s_%d", field, i);
+            }
+        }
+        std::fprintf(output, ",get_state_us,state_controller_us,run_model_us,set_command_us\n");
+    }
+
+    enum Stage { kGetState, kStateController, kRunModel, kSetCommand, kStages };
+    const char *stage_names[kStages] = {"GetState", "StateController", "RunModel", "SetCommand"};
+    LoopHistogram stage_time[kStages];
+
+    std::vector<double> recorded(reader.Width());
+    std::vector<double> row(columns.size());
+    LowState_ low_state;
+    IMUState_ imu_torso;
+    uint64_t tick = 0;
+    int64_t stamp_ns = 0;
+    int64_t first_stamp_ns = 0;
+    uint64_t ticks = 0;
+    const auto replay_start = std::chrono::steady_clock::now();
+    while (reader.Next(tick, stamp_ns, recorded.data()))
+    {
+        if (ticks == 0)
+        {
+            first_stamp_ns = stamp_ns;
+        }
+        if (realtime)
+        {
+            std::this_thread::sleep_until(replay_start + std::chrono::nanoseconds(stamp_ns - first_stamp_ns));
+        }
+
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+            row[i] = column_index[i] < 0 ? 0.0 : recorded[column_index[i]];
+        }
+        LowStateFromRow(row.data(), low_state, imu_torso);
+        // what the DDS callbacks would have published before this tick
+        this->unitree_low_state_buffer.Write(low_state);
+        this->unitree_imu_torso_buffer.Write(imu_torso);
+
+        // RobotControl with every stage timed, RunModel runs inline at the rate loop_rl would call it
+        int64_t elapsed_ns[kStages] = {0, 0, 0, 0};
+        auto timed = [&](Stage stage, const std::function<void()> &function)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            elapsed_ns[stage] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            stage_time[stage].record(elapsed_ns[stage]);
+        };
+        this->UpdateControlInput();
+        timed(kGetState, [this] { this->GetState(&this->robot_state); });
+        timed(kStateController, [this] { this->StateController(&this->robot_state, &this->robot_command); });
+        if (ticks % this->params.decimation == 0)
+        {
+            timed(kRunModel, [this] { this->RunModel(); });
+        }
+        timed(kSetCommand, [this] { this->SetCommand(&this->robot_command); });
+
+        if (output)
+        {
+            const auto &command = this->robot_command.motor_command;
+            const decltype(command.q) *fields[] = {&command.q, &command.dq, &command.kp, &command.kd, &command.tau};
+            std::fprintf(output, "%llu,%lld", static_cast<unsigned long long>(tick), static_cast<long long>(stamp_ns));
+            for (const auto field : fields)
+            {
+                for (int i = 0; i < this->params.num_of_dofs; ++i)
+                {
+                    std::fprintf(output, ",%.9g", (*field)[i]);
+                }
+            }
+            for (int stage = 0; stage < kStages; ++stage)
+            {
+                std::fprintf(output, ",%.3f", elapsed_ns[stage] / 1e3);
+            }
+            std::fprintf(output, "\n");
+        }
+        ++ticks;
+    }
+    const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - replay_start).count();
+    if (output)
+    {
+        std::fclose(output);
+    }
+
+    std::cout << LOGGER::INFO << "Replayed " << ticks << " ticks of " << recording_path << " in " << wall_s << " s";
+    if (reader.Dropped() > 0)
+    {
+        std::cout << ", the recorder dropped " << reader.Dropped() << " rows";
+    }
+    std::cout << std::endl;
+    for (int stage = 0; stage < kStages; ++stage)
+    {
+        const LoopHistogram::Snapshot s = stage_time[stage].snapshot();
+        std::cout << LOGGER::INFO << stage_names[stage] << " calls: " << s.count
+                  << ", exec(us) mean/p50/p99/max: " << s.meanUs() << "/" << s.percentileUs(0.5) << "/" << s.percentileUs(0.99) << "/" << s.maxUs()
+                  << std::endl;
+    }
+    return 0;
 }
 
 #if !defined(USE_CMAKE) && defined(USE_ROS)
@@ -485,21 +645,49 @@ int main(int argc, char **argv)
 {
     if (argc < 2)
     {
-        std::cout << "Usage: " << argv[0] << " networkInterface [wheel]" << std::endl;
+        std::cout << "Usage: " << argv[0] << " networkInterface [--record lowstate.rltl]" << std::endl;
+        std::cout << "       " << argv[0] << " --replay lowstate.rltl [--realtime] [--output commands.csv]" << std::endl;
         exit(-1);
     }
+
+    std::string record_path, replay_path, output_path;
+    bool realtime = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) record_path = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc) replay_path = argv[++i];
+        else if (arg == "--output" && i + 1 < argc) output_path = argv[++i];
+        else if (arg == "--realtime") realtime = true;
+    }
+
+    // Offline: no DDS, the recording stands in for the robot and the commands stop at SetCommand
+    if (!replay_path.empty())
+    {
+#if defined(USE_ROS1) && defined(USE_ROS)
+        ros::init(argc, argv, "rl_sar");
+#elif defined(USE_ROS2) && defined(USE_ROS)
+        rclcpp::init(argc, argv);
+#endif
+        int result = std::make_shared<RL_Real>(false)->Replay(replay_path, realtime, output_path);
+#if defined(USE_ROS2) && defined(USE_ROS)
+        rclcpp::shutdown();
+#endif
+        return result;
+    }
+
     ChannelFactory::Instance()->Init(0, argv[1]);
 #if defined(USE_ROS1) && defined(USE_ROS)
     signal(SIGINT, signalHandler);
     ros::init(argc, argv, "rl_sar");
-    RL_Real rl_sar;
+    RL_Real rl_sar(true, record_path);
     ros::spin();
 #elif defined(USE_ROS2) && defined(USE_ROS)
     rclcpp::init(argc, argv);
-    rclcpp::spin(std::make_shared<RL_Real>());
+    rclcpp::spin(std::make_shared<RL_Real>(true, record_path));
     rclcpp::shutdown();
 #elif defined(USE_CMAKE) || !defined(USE_ROS)
-    RL_Real rl_sar;
+    RL_Real rl_sar(true, record_path);
     while (1) { sleep(10); }
 #endif
     return 0;
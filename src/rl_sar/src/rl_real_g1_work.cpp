@@ -89,8 +89,8 @@ RL_Real::RL_Real()
     this->loop_plot = std::make_shared<LoopFunc>("loop_plot", 0.002, std::bind(&RL_Real::Plot, this));
     this->loop_plot->start();
 #endif
-#ifdef CSV_LOGGER
-    this->CSVInit(this->robot_name);
+#ifdef TELEMETRY
+    this->TelemetryInit(this->robot_name);
 #endif
 }
 
@@ -250,78 +250,51 @@ void RL_Real::RobotControl()
 
 void RL_Real::RunModel()
 {
+    this->ApplyPendingPolicyState();
     if (this->rl_init_done)
     {
         this->episode_length_buf += 1;
-        this->obs.ang_vel = torch::tensor(this->robot_state.imu.gyroscope).unsqueeze(0);
+        this->obs.ang_vel = this->robot_state.imu.gyroscope;
         if (this->control.navigation_mode)
         {
 #if !defined(USE_CMAKE) && defined(USE_ROS)
-            this->obs.commands = torch::tensor({{this->cmd_vel.linear.x, this->cmd_vel.linear.y, this->cmd_vel.angular.z}});
+            this->obs.commands = {{this->cmd_vel.linear.x, this->cmd_vel.linear.y, this->cmd_vel.angular.z}};
 #endif
         }
         else
         {
-            this->obs.commands = torch::tensor({{this->control.x, this->control.y, this->control.yaw}});
+            this->obs.commands = {{this->control.x, this->control.y, this->control.yaw}};
         }
-        this->obs.base_quat = torch::tensor(this->robot_state.imu.quaternion).unsqueeze(0);
-        this->obs.dof_pos = torch::tensor(this->robot_state.motor_state.q).narrow(0, 0, this->params.num_of_dofs).unsqueeze(0);
-        this->obs.dof_vel = torch::tensor(this->robot_state.motor_state.dq).narrow(0, 0, this->params.num_of_dofs).unsqueeze(0);
+        this->obs.base_quat = this->robot_state.imu.quaternion;
+        this->obs.dof_pos = this->robot_state.motor_state.q;
+        this->obs.dof_vel = this->robot_state.motor_state.dq;
 
         this->obs.actions = this->Forward();
         this->ComputeOutput(this->obs.actions, this->output_dof_pos, this->output_dof_vel, this->output_dof_tau);
 
+        // ComputeOutput rewrites the outputs in place every tick, the queues get copies
         if (this->output_dof_pos.defined() && this->output_dof_pos.numel() > 0)
         {
-            output_dof_pos_queue.push(this->output_dof_pos);
+            output_dof_pos_queue.push(this->output_dof_pos.clone());
         }
         if (this->output_dof_vel.defined() && this->output_dof_vel.numel() > 0)
         {
-            output_dof_vel_queue.push(this->output_dof_vel);
+            output_dof_vel_queue.push(this->output_dof_vel.clone());
         }
         if (this->output_dof_tau.defined() && this->output_dof_tau.numel() > 0)
         {
-            output_dof_tau_queue.push(this->output_dof_tau);
+            output_dof_tau_queue.push(this->output_dof_tau.clone());
         }
 
         // this->TorqueProtect(this->output_dof_tau);
         // this->AttitudeProtect(this->robot_state.imu.quaternion, 75.0f, 75.0f);
 
-#ifdef CSV_LOGGER
-        torch::Tensor tau_est = torch::tensor(this->robot_state.motor_state.tau_est).unsqueeze(0);
-        this->CSVLogger(this->output_dof_tau, tau_est, this->obs.dof_pos, this->output_dof_pos, this->obs.dof_vel);
+#ifdef TELEMETRY
+        this->TelemetryRecord();
 #endif
     }
 }
 
-torch::Tensor RL_Real::Forward()
-{
-    torch::autograd::GradMode::set_enabled(false);
-
-    torch::Tensor clamped_obs = this->ComputeObservation();
-
-    torch::Tensor actions;
-    if (!this->params.observations_history.empty())
-    {
-        this->history_obs_buf.insert(clamped_obs);
-        this->history_obs = this->history_obs_buf.get_obs_vec(this->params.observations_history);
-        actions = this->model.forward({this->history_obs}).toTensor();
-    }
-    else
-    {
-        actions = this->model.forward({clamped_obs}).toTensor();
-    }
-
-    if (this->params.clip_actions_upper.numel() != 0 && this->params.clip_actions_lower.numel() != 0)
-    {
-        return torch::clamp(actions, this->params.clip_actions_lower, this->params.clip_actions_upper);
-    }
-    else
-    {
-        return actions;
-    }
-}
-
 void RL_Real::Plot()
 {
     this->plot_t.erase(this->plot_t.begin());
@@ -75,6 +75,9 @@ RL_Sim::RL_Sim()
     torch::autograd::GradMode::set_enabled(false);
     torch::set_num_threads(4);
 
+    // load every policy the FSM can switch to, state entry then only activates it
+    this->PreloadPolicies(FSMManager::GetInstance().GetPolicies(this->robot_name));
+
     // init robot
 #if defined(USE_ROS1)
     this->joint_publishers_commands.resize(this->params.num_of_dofs);
@@ -172,8 +175,8 @@ RL_Sim::RL_Sim()
     this->loop_plot = std::make_shared<LoopFunc>("loop_plot", 0.001, std::bind(&RL_Sim::Plot, this));
     this->loop_plot->start();
 #endif
-#ifdef CSV_LOGGER
-    this->CSVInit(this->robot_name);
+#ifdef TELEMETRY
+    this->TelemetryInit(this->robot_name);
 #endif
 
     std::cout << LOGGER::INFO << "RL_Sim start" << std::endl;
@@ -506,113 +509,37 @@ void RL_Sim::RobotStateCallback(const robot_msgs::msg::RobotState::SharedPtr msg
 
 void RL_Sim::RunModel()
 {
+    this->ApplyPendingPolicyState();
     if (this->rl_init_done && simulation_running)
     {
         this->episode_length_buf += 1;
-        // this->obs.lin_vel = torch::tensor({{this->vel.linear.x, this->vel.linear.y, this->vel.linear.z}});
-        this->obs.ang_vel = torch::tensor(this->robot_state.imu.gyroscope).unsqueeze(0);
+        // this->obs.lin_vel = {{this->vel.linear.x, this->vel.linear.y, this->vel.linear.z}};
+        this->obs.ang_vel = this->robot_state.imu.gyroscope;
         if (this->control.navigation_mode)
         {
-            this->obs.commands = torch::tensor({{this->cmd_vel.linear.x, this->cmd_vel.linear.y, this->cmd_vel.angular.z}});
+            this->obs.commands = {{this->cmd_vel.linear.x, this->cmd_vel.linear.y, this->cmd_vel.angular.z}};
         }
         else
         {
-            this->obs.commands = torch::tensor({{this->control.x, this->control.y, this->control.yaw}});
+            this->obs.commands = {{this->control.x, this->control.y, this->control.yaw}};
         }
-        this->obs.base_quat = torch::tensor(this->robot_state.imu.quaternion).unsqueeze(0);
-        this->obs.dof_pos = torch::tensor(this->robot_state.motor_state.q).narrow(0, 0, this->params.num_of_dofs).unsqueeze(0);
-        this->obs.dof_vel = torch::tensor(this->robot_state.motor_state.dq).narrow(0, 0, this->params.num_of_dofs).unsqueeze(0);
+        this->obs.base_quat = this->robot_state.imu.quaternion;
+        this->obs.dof_pos = this->robot_state.motor_state.q;
+        this->obs.dof_vel = this->robot_state.motor_state.dq;
 
         this->obs.actions = this->Forward();
         this->ComputeOutput(this->obs.actions, this->output_dof_pos, this->output_dof_vel, this->output_dof_tau);
 
-        if (this->output_dof_pos.defined() && this->output_dof_pos.numel() > 0)
-        {
-            output_dof_pos_queue.push(this->output_dof_pos);
-        }
-        if (this->output_dof_vel.defined() && this->output_dof_vel.numel() > 0)
-        {
-            output_dof_vel_queue.push(this->output_dof_vel);
-        }
-        if (this->output_dof_tau.defined() && this->output_dof_tau.numel() > 0)
-        {
-            output_dof_tau_queue.push(this->output_dof_tau);
-        }
+        this->PublishOutput();
 
         // this->TorqueProtect(this->output_dof_tau);
 
-#ifdef CSV_LOGGER
-        torch::Tensor tau_est = torch::zeros({1, this->params.num_of_dofs});
-        for (int i = 0; i < this->params.num_of_dofs; ++i)
-        {
-            tau_est[0][i] = this->joint_efforts[this->params.joint_controller_names[i]];
-        }
-        this->CSVLogger(this->output_dof_tau, tau_est, this->obs.dof_pos, this->output_dof_pos, this->obs.dof_vel);
+#ifdef TELEMETRY
+        this->TelemetryRecord();
 #endif
     }
 }
 
-torch::Tensor RL_Sim::Forward()
-{
-    torch::autograd::GradMode::set_enabled(false);
-
-    // Try ONNX inference first if model is loaded
-    if (this->onnx_engine.IsModelLoaded()) {
-        try {
-            std::vector<float> clamped_obs = this->ComputeObservationFloat();
-            std::vector<float> actions;
-            
-            if (this->params.observations_history.size() != 0) {
-                torch::Tensor obs_tensor = this->ComputeObservation();
-                this->history_obs_buf.insert(obs_tensor);
-                this->history_obs = this->history_obs_buf.get_obs_vec(this->params.observations_history);
-                std::vector<float> history_obs_vec = this->TensorToVector(this->history_obs);
-                std::vector<int64_t> input_shape = {1, static_cast<int64_t>(history_obs_vec.size())};
-                actions = this->onnx_engine.Forward(history_obs_vec, input_shape);
-            } else {
-                std::vector<int64_t> input_shape = {1, static_cast<int64_t>(clamped_obs.size())};
-                actions = this->onnx_engine.Forward(clamped_obs, input_shape);
-            }
-            
-            // Convert back to tensor
-            torch::Tensor actions_tensor = this->VectorToTensor(actions, {1, static_cast<int64_t>(actions.size())});
-            
-            // Apply clipping
-            if (this->params.clip_actions_upper.numel() != 0 && this->params.clip_actions_lower.numel() != 0) {
-                return torch::clamp(actions_tensor, this->params.clip_actions_lower, this->params.clip_actions_upper);
-            } else {
-                return actions_tensor;
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "[Forward] ONNX inference failed: " << e.what() << ", falling back to PyTorch" << std::endl;
-        }
-    }
-
-    // Fallback to PyTorch inference
-    torch::Tensor clamped_obs = this->ComputeObservation();
-
-    torch::Tensor actions;
-    if (this->params.observations_history.size() != 0)
-    {
-        this->history_obs_buf.insert(clamped_obs);
-        this->history_obs = this->history_obs_buf.get_obs_vec(this->params.observations_history);
-        actions = this->model.forward({this->history_obs}).toTensor();
-    }
-    else
-    {
-        actions = this->model.forward({clamped_obs}).toTensor();
-    }
-
-    if (this->params.clip_actions_upper.numel() != 0 && this->params.clip_actions_lower.numel() != 0)
-    {
-        return torch::clamp(actions, this->params.clip_actions_lower, this->params.clip_actions_upper);
-    }
-    else
-    {
-        return actions;
-    }
-}
-
 void RL_Sim::Plot()
 {
     this->plot_t.erase(this->plot_t.begin());
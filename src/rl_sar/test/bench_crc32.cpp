@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "crc32.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/*
+Usage: bench_crc32 [words] [iterations]
+
+Times each crc32 variant on a buffer the size of LowCmd_ (246 words) by default and prints the mean
+time per checksum.
+*/
+
+template <typename F>
+static void bench(const char *name, F func, const std::vector<uint32_t> &words, int iterations)
+{
+    volatile uint32_t sink = 0;
+    for (int i = 0; i < iterations / 10 + 1; ++i) sink = sink ^ func(words.data(), words.size());
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) sink = sink ^ func(words.data(), words.size());
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << ns << " ns/checksum" << std::setw(10) << words.size() * 4 / ns << " GB/s" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    const size_t len = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 246;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 200000;
+
+    std::vector<uint32_t> words(len);
+    std::mt19937 rng(42);
+    for (uint32_t &word : words) word = rng();
+
+    std::cout << "crc32 over " << len << " words, " << iterations << " iterations" << std::endl;
+    bench("bitwise", crc32::Bitwise, words, iterations);
+    bench("slice-by-8", crc32::SliceBy8, words, iterations);
+#if CRC32_HAS_HARDWARE
+    bench("hardware", crc32::Hardware, words, iterations);
+#endif
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "onnx_engine.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+/*
+Usage: bench_onnx_engine <model.onnx> [iterations]
+
+Runs the same model through Run() without IoBinding, where every call creates its input and output tensors, and
+with IoBinding (ForwardBound) and prints p50/p99 latency of each. Single- and two-input (obs, time_step) models work.
+*/
+
+static void print_latency(const std::string& name, std::vector<double>& samples)
+{
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double s : samples) sum += s;
+    auto percentile = [&](double p) { return samples[static_cast<size_t>(p * (samples.size() - 1))]; };
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(1)
+              << " mean: " << std::setw(8) << sum / samples.size() << " us"
+              << "  p50: " << std::setw(8) << percentile(0.50) << " us"
+              << "  p99: " << std::setw(8) << percentile(0.99) << " us"
+              << "  max: " << std::setw(8) << samples.back() << " us" << std::endl;
+}
+
+static size_t input_size(const ONNXInferenceEngine& engine)
+{
+    size_t count = 1;
+    for (int64_t dim : engine.GetInputShapes()[0]) count *= dim > 0 ? static_cast<size_t>(dim) : 1;
+    return count;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " <model.onnx> [iterations]" << std::endl;
+        return 1;
+    }
+    const std::string model_path = argv[1];
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 2000;
+    const int warmup = 50;
+    if (iterations <= 0)
+    {
+        std::cout << "iterations must be a positive number, got " << (argc > 2 ? argv[2] : "") << std::endl;
+        return 1;
+    }
+
+    ONNXInferenceEngine unbound;
+    unbound.SetUseIoBinding(false);
+    unbound.LoadModel(model_path);
+
+    ONNXInferenceEngine bound;
+    bound.LoadModel(model_path);
+    if (!bound.IsIoBindingEnabled())
+    {
+        std::cout << "IoBinding could not be enabled for " << model_path << std::endl;
+        return 1;
+    }
+
+    std::vector<float> obs(input_size(unbound), 0.1f);
+    std::vector<double> unbound_us, bound_us;
+    unbound_us.reserve(iterations);
+    bound_us.reserve(iterations);
+
+    for (int i = 0; i < warmup + iterations; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        unbound.Run(obs.data(), obs.size(), static_cast<float>(i));
+        auto end = std::chrono::steady_clock::now();
+        if (i >= warmup) unbound_us.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+
+    for (int i = 0; i < warmup + iterations; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bound.ForwardBound(obs.data(), obs.size(), static_cast<float>(i));
+        auto end = std::chrono::steady_clock::now();
+        if (i >= warmup) bound_us.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+
+    std::cout << "Model: " << model_path << ", iterations: " << iterations << std::endl;
+    print_latency("Unbound", unbound_us);
+    print_latency("Bound", bound_us);
+    return 0;
+}
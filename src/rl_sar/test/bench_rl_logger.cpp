@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "rl_logger.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+/*
+Usage: bench_rl_logger [joints] [ticks]
+
+Times one control tick of RLLogger as the G1 deploy code logs it, BeginRow() and RecordJointData() for every
+joint, with the chunks reserved up front (steady state) and without (every chunk_rows ticks allocate), and prints
+the mean time per tick. Defaults to 29 joints and 100000 ticks.
+*/
+
+static void bench(const char *name, int joints, int ticks, bool reserve)
+{
+    RLLogger logger;
+    logger.RegisterJoints(joints);
+    if (reserve)
+    {
+        logger.Reserve(ticks);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < ticks; ++t)
+    {
+        logger.BeginRow();
+        for (int j = 0; j < joints; ++j)
+        {
+            logger.RecordJointData(j, 0.1 * j, 0.1 * j + 0.01, 0.5, 100.0, 2.0, t * 0.001);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / ticks;
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << ns << " ns/tick" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    const int joints = argc > 1 ? std::atoi(argv[1]) : 29;
+    const int ticks = argc > 2 ? std::atoi(argv[2]) : 100000;
+    if (joints <= 0 || ticks <= 0)
+    {
+        std::cout << "joints and ticks must be positive numbers" << std::endl;
+        return 1;
+    }
+
+    std::cout << "RLLogger, " << joints << " joints, " << ticks << " ticks" << std::endl;
+    bench("reserved", joints, ticks, true);
+    bench("growing", joints, ticks, false);
+    return 0;
+}
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "rl_sdk.hpp"
+#include "observation_buffer.hpp"
+#include "fsm.hpp"
+#include "crc32.hpp"
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+Usage: rl_sar_bench [--benchmark_filter=<regex>] [--benchmark_out=<file.json> --benchmark_out_format=json]
+
+Microbenchmarks of the rl_sdk stages the G1 control and model loops run, for every config the G1 FSM
+preloads (FSMManager::GetPolicies) plus kExtraConfigs. Benchmarks are named <stage>/<config>, e.g.
+ComputeObservation/robomimic/loco, so --benchmark_filter selects stages or configs. A config whose model files are
+missing is reported and left out, with the shipped configs that is robomimic/beyonddance, whose ONNX model is not in
+the tree. robomimic/dance is added for that reason, it is the one ONNX policy on disk and it stacks a history, so
+the Onnx* benchmarks only run for it.
+
+Compare two commits with the JSON files and compare.py from the Google Benchmark sources:
+  rl_sar_bench --benchmark_out=base.json --benchmark_out_format=json --benchmark_repetitions=5
+  compare.py benchmarks base.json new.json
+*/
+
+namespace
+{
+
+const char *kRobotName = "g1";
+// LowCmd_ without the crc word, what RL_Real::Crc32Core checksums every control tick
+const int kLowCmdWords = 246;
+// benchmarked in addition to the FSM policies
+const std::vector<std::string> kExtraConfigs = {"robomimic/dance"};
+
+// RL with the robot replaced by a fixed state near default_dof_pos. The benchmarks call the stages directly,
+// Forward is RL::Forward, the one RunModel calls, so the "Step" benchmark matches RunModel.
+class RL_Bench : public RL
+{
+public:
+    explicit RL_Bench(const std::string &config)
+    {
+        this->robot_name = kRobotName;
+        this->config_name = config;
+        this->ang_vel_type = "ang_vel_body";
+        this->ReadYamlBase(this->robot_name);
+    }
+
+    std::string RobotPath() const { return this->robot_name + "/" + this->config_name; }
+
+    // What RL_Real::RunModel sets before Forward, with a slightly tilted body and joints off their defaults
+    void SetState()
+    {
+        const int num_of_dofs = this->params.num_of_dofs;
+        std::mt19937 rng(0);
+        std::uniform_real_distribution<double> uniform(-0.1, 0.1);
+        const double axis[3] = {0.6, 0.8, 0.0};
+        quaternion::FromAxisAngle(axis, 0.05, this->robot_state.imu.quaternion.data());
+        for (int i = 0; i < 3; ++i)
+        {
+            this->robot_state.imu.gyroscope[i] = uniform(rng);
+        }
+        for (int i = 0; i < num_of_dofs; ++i)
+        {
+            this->robot_state.motor_state.q[i] = this->params.joint.default_dof_pos[i] + uniform(rng);
+            this->robot_state.motor_state.dq[i] = uniform(rng);
+        }
+
+        // the fsm sets these on state entry, calc_anchor_called = 2 keeps the anchor frame calibrated on identity
+        this->motion_length = 10.0f;
+        this->episode_length_buf = 1;
+        this->calc_anchor_called = 2;
+        this->init_to_world.setIdentity();
+
+        this->obs.ang_vel = this->robot_state.imu.gyroscope;
+        this->obs.commands = {{0.5, 0.0, 0.1}};
+        this->obs.base_quat = this->robot_state.imu.quaternion;
+        this->obs.dof_pos = this->robot_state.motor_state.q;
+        this->obs.dof_vel = this->robot_state.motor_state.dq;
+    }
+
+    // Input of the policy for the current observation, the stacked history when the config has one, as in
+    // RL::Forward. The backend benchmarks time inference on it alone
+    torch::Tensor PolicyInput()
+    {
+        torch::Tensor clamped_obs = this->ComputeObservation();
+        if (this->params.observations_history.empty())
+        {
+            return clamped_obs;
+        }
+        this->history_obs_buf.insert(clamped_obs);
+        this->history_obs_buf.gather_obs_vec(this->history_obs.data_ptr<float>());
+        return this->history_obs;
+    }
+
+    void GetState(RobotState<double> *state) override {}
+    void SetCommand(const RobotCommand<double> *command) override {}
+};
+
+// One loaded robot per config, built once in main and shared by every benchmark of that config
+std::map<std::string, std::unique_ptr<RL_Bench>> robots;
+
+void BM_Crc32Core(benchmark::State &state)
+{
+    std::vector<uint32_t> words(state.range(0));
+    std::mt19937 rng(42);
+    for (uint32_t &word : words) word = rng();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(crc32::Compute(words.data(), words.size()));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * words.size() * sizeof(uint32_t)));
+}
+BENCHMARK(BM_Crc32Core)->Name("Crc32Core")->Arg(kLowCmdWords);
+
+void BM_ReadYamlBase(benchmark::State &state)
+{
+    RL_Bench robot("");
+    for (auto _ : state)
+    {
+        robot.ReadYamlBase(kRobotName);
+    }
+}
+BENCHMARK(BM_ReadYamlBase)->Name("ReadYamlBase")->Unit(benchmark::kMicrosecond);
+
+void BM_ReadYamlRL(benchmark::State &state, RL_Bench *robot)
+{
+    ModelParams params = robot->params;
+    for (auto _ : state)
+    {
+        robot->ReadYamlRL(robot->RobotPath(), params);
+    }
+}
+
+// Cold start: base.yaml is read, then InitRL finds nothing preloaded and loads the models from disk
+void BM_InitRL(benchmark::State &state, const std::string &config)
+{
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::unique_ptr<RL_Bench> robot(new RL_Bench(config));
+        state.ResumeTiming();
+        robot->InitRL(robot->RobotPath());
+        robot->ApplyPendingPolicyState();
+        state.PauseTiming();
+        robot.reset();
+        state.ResumeTiming();
+    }
+}
+
+// Warm policy switch with the PolicyState built on the calling thread, as the evaluation tool does
+void BM_ActivatePolicy(benchmark::State &state, RL_Bench *robot)
+{
+    for (auto _ : state)
+    {
+        robot->ActivatePolicy(robot->active_policy);
+    }
+    robot->SetState();
+}
+
+// What a state entry and the next model tick cost once the prepare worker built the PolicyState
+void BM_SwitchPolicy(benchmark::State &state, RL_Bench *robot)
+{
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        // PreparePolicy frees the previous retired state too, on the worker
+        std::atomic_store(&robot->retired_policy_state, std::shared_ptr<PolicyState>());
+        std::shared_ptr<PolicyState> prepared = RL::BuildPolicyState(robot->active_policy);
+        state.ResumeTiming();
+        robot->SwitchPolicy(prepared);
+        robot->ApplyPendingPolicyState();
+    }
+    robot->SetState();
+}
+
+void BM_ComputeObservation(benchmark::State &state, RL_Bench *robot)
+{
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(robot->ComputeObservation().data_ptr<float>());
+    }
+}
+
+void BM_ObservationBufferInsert(benchmark::State &state, RL_Bench *robot)
+{
+    torch::Tensor obs = robot->ComputeObservation().clone();
+    ObservationBuffer &buffer = robot->history_obs_buf;
+    for (auto _ : state)
+    {
+        buffer.insert(obs);
+    }
+}
+
+void BM_ObservationBufferGather(benchmark::State &state, RL_Bench *robot)
+{
+    ObservationBuffer &buffer = robot->history_obs_buf;
+    buffer.insert(robot->ComputeObservation());
+    std::vector<float> out(buffer.obs_vec_size());
+    for (auto _ : state)
+    {
+        buffer.gather_obs_vec(out.data());
+        benchmark::ClobberMemory();
+    }
+}
+
+// The tensor API, kept next to gather_obs_vec to show what the control loop saves
+void BM_ObservationBufferGetObsVec(benchmark::State &state, RL_Bench *robot)
+{
+    ObservationBuffer &buffer = robot->history_obs_buf;
+    buffer.insert(robot->ComputeObservation());
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(buffer.get_obs_vec(robot->params.observations_history).data_ptr<float>());
+    }
+}
+
+// What Forward runs: the preallocated outputs selected by InitOnnxOutputs
+void BM_OnnxRun(benchmark::State &state, RL_Bench *robot)
+{
+    torch::Tensor input = robot->PolicyInput().clone();
+    for (auto _ : state)
+    {
+        robot->onnx_engine->Run(input.data_ptr<float>(), input.numel(), 1.0f);
+        benchmark::DoNotOptimize(robot->onnx_engine->GetOutputView<float>(0).data);
+    }
+}
+
+// RL::Forward as RunModel calls it: observation, history gather, inference and clipping, for either backend
+void BM_Forward(benchmark::State &state, RL_Bench *robot)
+{
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(robot->Forward().data_ptr<float>());
+    }
+    robot->SetState();
+}
+
+void BM_TorchForward(benchmark::State &state, RL_Bench *robot)
+{
+    torch::Tensor input = robot->PolicyInput().clone();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(robot->model.forward({input}).toTensor().data_ptr<float>());
+    }
+}
+
+void BM_ComputeOutput(benchmark::State &state, RL_Bench *robot)
+{
+    torch::Tensor actions = torch::full({1, robot->params.num_of_dofs}, 0.1f);
+    for (auto _ : state)
+    {
+        robot->ComputeOutput(actions, robot->output_dof_pos, robot->output_dof_vel, robot->output_dof_tau);
+    }
+}
+
+// RL_Real::RunModel without the robot: observation, inference, output and the mailbox publish
+void BM_Step(benchmark::State &state, RL_Bench *robot)
+{
+    for (auto _ : state)
+    {
+        robot->obs.actions = robot->Forward();
+        robot->ComputeOutput(robot->obs.actions, robot->output_dof_pos, robot->output_dof_vel, robot->output_dof_tau);
+        robot->PublishOutput();
+    }
+    robot->SetState();
+}
+
+void RegisterConfig(const std::string &config, RL_Bench *robot)
+{
+    const std::string suffix = "/" + config;
+    benchmark::RegisterBenchmark(("ReadYamlRL" + suffix).c_str(), BM_ReadYamlRL, robot)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark(("InitRL" + suffix).c_str(), BM_InitRL, config)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("ActivatePolicy" + suffix).c_str(), BM_ActivatePolicy, robot)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark(("SwitchPolicy" + suffix).c_str(), BM_SwitchPolicy, robot)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark(("ComputeObservation" + suffix).c_str(), BM_ComputeObservation, robot);
+    if (!robot->params.observations_history.empty())
+    {
+        benchmark::RegisterBenchmark(("ObservationBuffer/insert" + suffix).c_str(), BM_ObservationBufferInsert, robot);
+        benchmark::RegisterBenchmark(("ObservationBuffer/gather_obs_vec" + suffix).c_str(), BM_ObservationBufferGather, robot);
+        benchmark::RegisterBenchmark(("ObservationBuffer/get_obs_vec" + suffix).c_str(), BM_ObservationBufferGetObsVec, robot);
+    }
+    if (robot->onnx_engine->IsModelLoaded())
+    {
+        benchmark::RegisterBenchmark(("OnnxRun" + suffix).c_str(), BM_OnnxRun, robot)->Unit(benchmark::kMicrosecond);
+    }
+    if (robot->pytorch_model_loaded)
+    {
+        benchmark::RegisterBenchmark(("TorchForward" + suffix).c_str(), BM_TorchForward, robot)->Unit(benchmark::kMicrosecond);
+    }
+    benchmark::RegisterBenchmark(("Forward" + suffix).c_str(), BM_Forward, robot)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark(("ComputeOutput" + suffix).c_str(), BM_ComputeOutput, robot)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark(("Step" + suffix).c_str(), BM_Step, robot)->Unit(benchmark::kMicrosecond);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+
+    // Same inference settings as RL_Real
+    torch::autograd::GradMode::set_enabled(false);
+    torch::set_num_threads(1);
+
+    std::vector<std::string> configs = FSMManager::GetInstance().GetPolicies(kRobotName);
+    for (const std::string &config : kExtraConfigs)
+    {
+        if (std::find(configs.begin(), configs.end(), config) == configs.end())
+        {
+            configs.push_back(config);
+        }
+    }
+    for (const std::string &config : configs)
+    {
+        std::unique_ptr<RL_Bench> robot(new RL_Bench(config));
+        try
+        {
+            robot->InitRL(robot->RobotPath());
+            robot->ApplyPendingPolicyState();
+        }
+        catch (const std::exception &e)
+        {
+            std::cout << LOGGER::WARNING << "Skipping " << robot->RobotPath() << ": " << e.what() << std::endl;
+            continue;
+        }
+        robot->SetState();
+        RegisterConfig(config, robot.get());
+        robots[config] = std::move(robot);
+    }
+    if (std::none_of(robots.begin(), robots.end(), [](const std::pair<const std::string, std::unique_ptr<RL_Bench>> &entry)
+                     { return entry.second->onnx_engine->IsModelLoaded(); }))
+    {
+        std::cout << LOGGER::WARNING << "No ONNX policy loaded, the Onnx* benchmarks are skipped" << std::endl;
+    }
+    benchmark::AddCustomContext("robot", kRobotName);
+    benchmark::AddCustomContext("robot_max_dofs", std::to_string(ROBOT_MAX_DOFS));
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "crc32.hpp"
+#include <iostream>
+#include <random>
+#include <vector>
+
+/*
+Checks every crc32 variant against the bit-by-bit routine RL_Real::Crc32Core used before, on random buffers
+of every length up to 300 words (LowCmd_ is 246 words) and on a few fixed patterns. Returns non-zero on any
+mismatch.
+
+Output:
+
+crc32 variants: bitwise slice-by-8 compute (hardware: no)
+checked 307 buffers, 0 mismatches
+*/
+
+// Verbatim copy of the original RL_Real::Crc32Core
+static uint32_t Crc32CoreReference(uint32_t *ptr, uint32_t len)
+{
+    unsigned int xbit = 0;
+    unsigned int data = 0;
+    unsigned int CRC32 = 0xFFFFFFFF;
+    const unsigned int dwPolynomial = 0x04c11db7;
+
+    for (unsigned int i = 0; i < len; ++i)
+    {
+        xbit = 1 << 31;
+        data = ptr[i];
+        for (unsigned int bits = 0; bits < 32; bits++)
+        {
+            if (CRC32 & 0x80000000)
+            {
+                CRC32 <<= 1;
+                CRC32 ^= dwPolynomial;
+            }
+            else
+            {
+                CRC32 <<= 1;
+            }
+
+            if (data & xbit)
+            {
+                CRC32 ^= dwPolynomial;
+            }
+            xbit >>= 1;
+        }
+    }
+
+    return CRC32;
+}
+
+static int check(std::vector<uint32_t> &words)
+{
+    uint32_t expected = Crc32CoreReference(words.data(), static_cast<uint32_t>(words.size()));
+    int mismatches = 0;
+    auto compare = [&](const char *name, uint32_t value)
+    {
+        if (value != expected)
+        {
+            std::cout << name << " mismatch on " << words.size() << " words: 0x" << std::hex << value
+                      << " != 0x" << expected << std::dec << std::endl;
+            ++mismatches;
+        }
+    };
+    compare("bitwise", crc32::Bitwise(words.data(), words.size()));
+    compare("slice-by-8", crc32::SliceBy8(words.data(), words.size()));
+#if CRC32_HAS_HARDWARE
+    compare("hardware", crc32::Hardware(words.data(), words.size()));
+#endif
+    compare("compute", crc32::Compute(words.data(), words.size()));
+    return mismatches;
+}
+
+int main()
+{
+    std::cout << "crc32 variants: bitwise slice-by-8 compute (hardware: " << (CRC32_HAS_HARDWARE ? "yes" : "no") << ")" << std::endl;
+
+    std::mt19937 rng(42);
+    int buffers = 0;
+    int mismatches = 0;
+    for (size_t len = 0; len <= 300; ++len)
+    {
+        std::vector<uint32_t> words(len);
+        for (uint32_t &word : words) word = rng();
+        mismatches += check(words);
+        ++buffers;
+    }
+    for (uint32_t pattern : {0x00000000u, 0xFFFFFFFFu, 0x80000000u, 0x00000001u, 0xA5A5A5A5u, 0x04C11DB7u})
+    {
+        std::vector<uint32_t> words(246, pattern);
+        mismatches += check(words);
+        ++buffers;
+    }
+
+    std::cout << "checked " << buffers << " buffers, " << mismatches << " mismatches" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
@@ -9,77 +9,185 @@
 #include <algorithm>
 
 /*
-Output:
+Checks the ring-buffer ObservationBuffer, both get_obs_vec and the gather_obs_vec copy plan, against a verbatim
+copy of the shifting implementation it replaced, for both priorities, several envs and more inserts than the
+history holds, so the ring wraps several times. Also checks the fixed example below, clear() and insert() on a
+default-constructed buffer. Returns non-zero on any mismatch.
+
+Fixed example: obs_dims=[2 3 4], history_length=3, observations_history=[0 0 1 2], inserting t-2, t-1, t
+  time: [ 1100 1200 2100 2200 2300 3100 3200 3300 3400 1100 1200 2100 2200 2300 3100 3200 3300 3400 110 120 210 220 230 310 320 330 340 11 12 21 22 23 31 32 33 34 ]
+  term: [ 1100 1200 1100 1200 110 120 11 12 2100 2200 2300 2100 2200 2300 210 220 230 21 22 23 3100 3200 3300 3400 3100 3200 3300 3400 310 320 330 340 31 32 33 34 ]
 
-Initializing buffer with: obs_dims=[2 3 4], history_length=3, observations_history=[0 0 1 2], priority=time
-Inserting observation t-2:
- 11  12  21  22  23  31  32  33  34
-[ CPULongType{1,9} ]
-Inserting observation t-1:
- 110  120  210  220  230  310  320  330  340
-[ CPULongType{1,9} ]
-Inserting observation t:
- 1100  1200  2100  2200  2300  3100  3200  3300  3400
-[ CPULongType{1,9} ]
-time priority output:
-[ 1100 1200 2100 2200 2300 3100 3200 3300 3400 1100 1200 2100 2200 2300 3100 3200 3300 3400 110 120 210 220 230 310 320 330 340 11 12 21 22 23 31 32 33 34 ]
-
-Initializing buffer with: obs_dims=[2 3 4], history_length=3, observations_history=[0 0 1 2], priority=term
-Inserting observation t-2:
- 11  12  21  22  23  31  32  33  34
-[ CPULongType{1,9} ]
-Inserting observation t-1:
- 110  120  210  220  230  310  320  330  340
-[ CPULongType{1,9} ]
-Inserting observation t:
- 1100  1200  2100  2200  2300  3100  3200  3300  3400
-[ CPULongType{1,9} ]
-term priority output:
-[ 1100 1200 1100 1200 110 120 11 12 2100 2200 2300 2100 2200 2300 210 220 230 21 22 23 3100 3200 3300 3400 3100 3200 3300 3400 310 320 330 340 31 32 33 34 ]
+Output:
 
+time: checked 48 histories, 0 mismatches
+term: checked 48 histories, 0 mismatches
 */
 
-void test_buffer(const std::string& priority)
+// Verbatim copy of the original shifting ObservationBuffer
+class ReferenceBuffer
+{
+public:
+    ReferenceBuffer(int num_envs, const std::vector<int>& obs_dims, int history_length, const std::string& priority)
+        : obs_dims(obs_dims), history_length(history_length), priority(priority)
+    {
+        for (int dim : obs_dims) num_obs += dim;
+        obs_buf = torch::zeros({num_envs, num_obs * history_length}, torch::dtype(torch::kFloat32));
+    }
+
+    void insert(torch::Tensor new_obs)
+    {
+        // Shift observations back.
+        torch::Tensor shifted_obs = obs_buf.index({torch::indexing::Slice(torch::indexing::None), torch::indexing::Slice(num_obs, num_obs * history_length)}).clone();
+        obs_buf.index({torch::indexing::Slice(torch::indexing::None), torch::indexing::Slice(0, num_obs * (history_length - 1))}) = shifted_obs;
+
+        // Add new observation.
+        obs_buf.index({torch::indexing::Slice(torch::indexing::None), torch::indexing::Slice(-num_obs, torch::indexing::None)}) = new_obs;
+    }
+
+    torch::Tensor get_obs_vec(std::vector<int> obs_ids)
+    {
+        std::vector<torch::Tensor> obs;
+
+        if (this->priority == "time")
+        {
+            for (int i = 0; i < obs_ids.size(); ++i)
+            {
+                int obs_id = obs_ids[i];
+                int slice_idx = history_length - obs_id - 1;
+                obs.push_back(obs_buf.index({torch::indexing::Slice(torch::indexing::None), torch::indexing::Slice(slice_idx * num_obs, (slice_idx + 1) * num_obs)}));
+            }
+        }
+        else if(this->priority == "term")
+        {
+            int obs_offset = 0;
+            for (size_t i = 0; i < obs_dims.size(); ++i)
+            {
+                int dim = obs_dims[i];
+                for (int step : obs_ids)
+                {
+                    int time_offset = (history_length - step - 1) * num_obs;
+                    int pos = obs_offset + time_offset;
+                    obs.push_back(obs_buf.index({torch::indexing::Slice(), torch::indexing::Slice(pos, pos + dim)}));
+                }
+                obs_offset += dim;
+            }
+        }
+
+        return torch::cat(obs, -1);
+    }
+
+private:
+    std::vector<int> obs_dims;
+    int history_length;
+    std::string priority;
+    int num_obs = 0;
+    torch::Tensor obs_buf;
+};
+
+static bool same(const torch::Tensor& a, const torch::Tensor& b)
+{
+    return a.sizes() == b.sizes() && torch::equal(a.to(torch::kFloat32), b.to(torch::kFloat32));
+}
+
+static int check_example(const std::string& priority, const std::vector<float>& expected)
 {
     std::vector<int> obs_dims = {2, 3, 4};
-    int num_envs = 1;
     std::vector<int> observations_history = {0, 0, 1, 2};
-    int history_length = *std::max_element(observations_history.begin(), observations_history.end()) + 1;
+    ObservationBuffer buffer(1, obs_dims, 3, priority);
 
-    std::cout << "Initializing buffer with: "
-                << "obs_dims=[" << obs_dims << "], "
-                << "history_length=" << history_length << ", "
-                << "observations_history=[" << observations_history << "], "
-                << "priority=" << priority << "\n";
+    torch::Tensor obs1 = torch::tensor({{11, 12, 21, 22, 23, 31, 32, 33, 34}}, torch::kFloat32);
+    buffer.insert(obs1);
+    buffer.insert(obs1 * 10);
+    buffer.insert(obs1 * 100);
 
-    ObservationBuffer buffer(num_envs, obs_dims, history_length, priority);
+    torch::Tensor history = buffer.get_obs_vec(observations_history);
+    torch::Tensor expected_tensor = torch::tensor(expected).unsqueeze(0);
+    if (!same(history, expected_tensor))
+    {
+        std::cout << priority << " example mismatch:\n" << history << "\n" << expected_tensor << std::endl;
+        return 1;
+    }
+    return 0;
+}
 
-    torch::Tensor obs1 = torch::tensor({{11, 12, 21, 22, 23, 31, 32, 33, 34}});
-    torch::Tensor obs2 = obs1 * 10;
-    torch::Tensor obs3 = obs1 * 100;
+static int check_against_reference(const std::string& priority)
+{
+    const std::vector<int> obs_dims = {2, 3, 4};
+    const std::vector<std::vector<int>> obs_id_sets = {{0}, {0, 1, 2, 3}, {0, 0, 1, 2}, {3, 1, 0}};
+    const int num_envs = 3;
+    const int history_length = 4;
+    const int inserts = 12;
 
-    std::cout << "Inserting observation t-2:\n" << obs1 << "\n";
-    buffer.insert(obs1);
+    ObservationBuffer buffer(num_envs, obs_dims, history_length, priority);
+    ReferenceBuffer reference(num_envs, obs_dims, history_length, priority);
+    torch::manual_seed(0);
 
-    std::cout << "Inserting observation t-1:\n" << obs2 << "\n";
-    buffer.insert(obs2);
+    int checked = 0;
+    int mismatches = 0;
+    for (int t = 0; t < inserts; ++t)
+    {
+        torch::Tensor obs = torch::randn({num_envs, 9});
+        buffer.insert(obs);
+        reference.insert(obs);
+        for (const std::vector<int>& obs_ids : obs_id_sets)
+        {
+            ++checked;
+            torch::Tensor expected = reference.get_obs_vec(obs_ids);
+            if (!same(buffer.get_obs_vec(obs_ids), expected))
+            {
+                std::cout << priority << " get_obs_vec mismatch after " << t + 1 << " inserts" << std::endl;
+                ++mismatches;
+            }
 
-    std::cout << "Inserting observation t:\n" << obs3 << "\n";
-    buffer.insert(obs3);
+            // The control loop path: a plan set once, rows gathered into caller memory
+            buffer.set_obs_ids(obs_ids);
+            torch::Tensor gathered = torch::full({num_envs, buffer.obs_vec_size()}, -1.0f);
+            buffer.gather_obs_vec(gathered.data_ptr<float>());
+            if (!same(gathered, expected))
+            {
+                std::cout << priority << " gather_obs_vec mismatch after " << t + 1 << " inserts" << std::endl;
+                ++mismatches;
+            }
+        }
+    }
 
-    auto history = buffer.get_obs_vec(observations_history);
+    // clear() empties the history, the reference starts over from a new buffer
+    buffer.clear();
+    if (!same(buffer.get_obs_vec({0, 1, 2, 3}), torch::zeros({num_envs, 4 * 9})))
+    {
+        std::cout << priority << " history not empty after clear()" << std::endl;
+        ++mismatches;
+    }
+
+    std::cout << priority << ": checked " << checked << " histories, " << mismatches << " mismatches" << std::endl;
+    return mismatches;
+}
 
-    std::cout << priority << " priority output:\n[ ";
-    for (int i = 0; i < history.size(1); ++i)
+static int check_default_constructed()
+{
+    ObservationBuffer buffer;
+    try
+    {
+        buffer.insert(torch::zeros({1, 9}));
+    }
+    catch (const std::logic_error&)
     {
-        std::cout << history.index({0, i}).item<float>() << " ";
+        return 0;
     }
-    std::cout << "]\n\n";
+    std::cout << "insert on a default-constructed buffer did not throw" << std::endl;
+    return 1;
 }
 
 int main()
 {
-    test_buffer("time");
-    test_buffer("term");
-    return 0;
+    int failures = 0;
+    failures += check_example("time", {1100, 1200, 2100, 2200, 2300, 3100, 3200, 3300, 3400, 1100, 1200, 2100, 2200, 2300, 3100, 3200, 3300, 3400,
+                                       110, 120, 210, 220, 230, 310, 320, 330, 340, 11, 12, 21, 22, 23, 31, 32, 33, 34});
+    failures += check_example("term", {1100, 1200, 1100, 1200, 110, 120, 11, 12, 2100, 2200, 2300, 2100, 2200, 2300, 210, 220, 230, 21, 22, 23,
+                                       3100, 3200, 3300, 3400, 3100, 3200, 3300, 3400, 310, 320, 330, 340, 31, 32, 33, 34});
+    failures += check_against_reference("time");
+    failures += check_against_reference("term");
+    failures += check_default_constructed();
+    return failures == 0 ? 0 : 1;
 }
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024-2025 Ziqi Fan
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "rl_logger.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+Checks the CSV RLLogger writes: a chunk size of 2 so rows span several chunks, columns in registration order,
+unwritten cells and columns registered after a row was started left empty, the per-column append behaviour without
+BeginRow(), and Clear() keeping the registered columns. Returns non-zero on any mismatch.
+*/
+
+static std::vector<std::string> ReadLines(const std::string &path)
+{
+    std::ifstream file(path);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line)) lines.push_back(line);
+    return lines;
+}
+
+static int Expect(const std::string &name, const std::vector<std::string> &lines, const std::vector<std::string> &expected)
+{
+    if (lines == expected)
+    {
+        return 0;
+    }
+    std::cout << name << " mismatch, got:" << std::endl;
+    for (const std::string &line : lines) std::cout << "  " << line << std::endl;
+    std::cout << "expected:" << std::endl;
+    for (const std::string &line : expected) std::cout << "  " << line << std::endl;
+    return 1;
+}
+
+static int CheckRows(const std::string &path)
+{
+    RLLogger logger(2);
+    logger.RegisterJoints(1);
+    const int time = logger.RegisterColumn("time");
+    for (int t = 0; t < 3; ++t)
+    {
+        logger.BeginRow();
+        logger.RecordJointData(0, t, t + 0.5, -t, 100, 2, 0.25);
+        if (t != 1) logger.Record(time, t * 0.02);
+    }
+    // registered while the third row is open, that row moves to a wider chunk
+    logger.Record("phase", 0.5);
+    logger.SaveToCSV(path);
+
+    const std::string header = "L_hip_pitch_target,L_hip_pitch_actual,L_hip_pitch_dq,L_hip_pitch_kp,L_hip_pitch_kd,L_hip_pitch_tau_est,time,phase";
+    return Expect("rows", ReadLines(path), {
+        header,
+        "0,0.5,0,100,2,0.25,0,",
+        "1,1.5,-1,100,2,0.25,,",
+        "2,2.5,-2,100,2,0.25,0.04,0.5",
+    });
+}
+
+static int CheckAppendAndClear(const std::string &path)
+{
+    RLLogger logger(4);
+    const int a = logger.RegisterColumn("a");
+    const int b = logger.RegisterColumn("b");
+    // without BeginRow a second write to a cell starts the next row
+    logger.Record(a, 1);
+    logger.Record(a, 2);
+    logger.Record(b, 3);
+    logger.SaveToCSV(path);
+    int failures = Expect("append", ReadLines(path), {"a,b", "1,", "2,3"});
+
+    logger.Clear();
+    if (logger.HasData() || logger.GetColumn("b") != b)
+    {
+        std::cout << "Clear() kept data or dropped the columns" << std::endl;
+        ++failures;
+    }
+    logger.Record(b, 4);
+    logger.SaveToCSV(path);
+    failures += Expect("clear", ReadLines(path), {"a,b", ",4"});
+    return failures;
+}
+
+int main()
+{
+    const std::string path = "test_rl_logger.csv";
+    int failures = 0;
+    failures += CheckRows(path);
+    failures += CheckAppendAndClear(path);
+    std::remove(path.c_str());
+    std::cout << (failures == 0 ? "all checks passed" : "checks failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}